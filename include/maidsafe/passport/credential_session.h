@@ -0,0 +1,69 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_CREDENTIAL_SESSION_H_
+#define MAIDSAFE_PASSPORT_CREDENTIAL_SESSION_H_
+
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/authentication/user_credentials.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+// Derives the symmetric key and initialisation vector for a set of user credentials once, so that a
+// passport can be encrypted or decrypted repeatedly without re-running the password-based key
+// derivation.  The session holds a single copy of each secret: the derived key and IV, and the
+// credentials needed for obfuscation (authentication::Obfuscate works from the raw credentials, so
+// they can't be reduced to derived material).  All are locked against swapping where the platform
+// permits, and wiped when the session is destroyed.
+class CredentialSession {
+ public:
+  // Throws if any of the credential fields are null.
+  explicit CredentialSession(const authentication::UserCredentials& user_credentials);
+  ~CredentialSession();
+
+  // Valid for the lifetime of the session.
+  const crypto::AES256Key& symm_key() const { return symm_key_; }
+  const crypto::AES256InitialisationVector& symm_iv() const { return symm_iv_; }
+
+  // Applies the credentials' obfuscation to 'data'.  Obfuscating twice restores the original.
+  NonEmptyString Obfuscate(const NonEmptyString& data) const;
+
+ private:
+  CredentialSession(const CredentialSession&) = delete;
+  CredentialSession(CredentialSession&&) = delete;
+  CredentialSession& operator=(CredentialSession) = delete;
+
+  std::vector<const std::string*> Secrets() const;
+
+  authentication::UserCredentials user_credentials_;
+  crypto::AES256Key symm_key_;
+  crypto::AES256InitialisationVector symm_iv_;
+  bool memory_locked_;
+};
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_CREDENTIAL_SESSION_H_
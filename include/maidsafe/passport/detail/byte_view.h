@@ -0,0 +1,103 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_BYTE_VIEW_H_
+#define MAIDSAFE_PASSPORT_DETAIL_BYTE_VIEW_H_
+
+#include <cstring>
+#include <istream>
+#include <streambuf>
+
+#include "boost/utility/string_ref.hpp"
+#include "cereal/archives/binary.hpp"
+
+#include "maidsafe/common/error.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// A non-owning view of contiguous bytes, e.g. part of a receive or decryption buffer.  The bytes
+// must outlive the view.
+typedef boost::string_ref ByteView;
+
+// Parses 'object' from 'bytes' in place, with the same binary archive as
+// maidsafe::ConvertFromString, so it accepts exactly what parsing a copy of the bytes would.
+// Throws as the archive does.
+template <typename T>
+void ParseFromView(ByteView bytes, T& object) {
+  class ViewBuffer : public std::streambuf {
+   public:
+    explicit ViewBuffer(ByteView view) {
+      char* begin(const_cast<char*>(view.data()));
+      setg(begin, begin, begin + view.size());
+    }
+  } buffer(bytes);
+  std::istream stream(&buffer);
+  cereal::BinaryInputArchive archive(stream);
+  archive(object);
+}
+
+// Reads fields laid out by the binary archive without copying, yielding string fields as views
+// into the underlying bytes.  Throws parsing_error if the bytes run out.
+class ByteViewReader {
+ public:
+  explicit ByteViewReader(ByteView bytes) : bytes_(bytes) {}
+
+  cereal::size_type ReadSize() {
+    cereal::size_type size(0);
+    if (bytes_.size() < sizeof(size))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    std::memcpy(&size, bytes_.data(), sizeof(size));
+    bytes_.remove_prefix(sizeof(size));
+    return size;
+  }
+
+  ByteView ReadString() {
+    const cereal::size_type size(ReadSize());
+    if (bytes_.size() < size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    ByteView string(bytes_.substr(0, static_cast<std::size_t>(size)));
+    bytes_.remove_prefix(static_cast<std::size_t>(size));
+    return string;
+  }
+
+  // Reads the element count of a sequence whose elements each occupy at least
+  // 'min_element_size' bytes, so that a corrupt count can't cause a huge allocation.
+  std::size_t ReadCount(std::size_t min_element_size) {
+    const cereal::size_type count(ReadSize());
+    if (count > bytes_.size() / min_element_size)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return static_cast<std::size_t>(count);
+  }
+
+  std::size_t remaining() const { return bytes_.size(); }
+
+ private:
+  ByteView bytes_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_BYTE_VIEW_H_
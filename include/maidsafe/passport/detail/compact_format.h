@@ -0,0 +1,105 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_COMPACT_FORMAT_H_
+#define MAIDSAFE_PASSPORT_DETAIL_COMPACT_FORMAT_H_
+
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/types.h"
+#include "maidsafe/common/data_types/data_type_values.h"
+
+#include "maidsafe/passport/detail/byte_view.h"
+#include "maidsafe/passport/detail/fob_cereal.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// The serialised forms of a Fob or PublicFob.  Their parsing constructors accept either.
+enum class WireFormat {
+  // The cereal encoding written by save(): a 4-byte tag, then each field with an 8-byte length.
+  kV1,
+  // The compact encoding below.
+  kV2
+};
+
+// Compact (v2) layout, with sizes as 2-byte little-endian integers:
+//   Fob:        version | tag | private key size | public key size | token size |
+//               [name (Mpid only, 64 bytes)] | private key | public key | validation token
+//   PublicFob:  version | tag | public key size | token size | public key | validation token
+// The name of any fob other than an Mpid is the hash of its public key and validation token, so it
+// is recomputed rather than sent.  The version byte has its top bit set, whereas a v1 encoding
+// opens with the low byte of a (small) tag value, so the first byte tells the formats apart.
+const std::uint8_t kCompactFormatVersion(0x82);
+const std::size_t kCompactFobHeaderSize(8);
+const std::size_t kCompactPublicFobHeaderSize(6);
+const std::size_t kCompactMpidNameSize(64);
+
+inline bool IsCompactFormat(ByteView serialised) {
+  return !serialised.empty() && static_cast<std::uint8_t>(serialised[0]) == kCompactFormatVersion;
+}
+
+// Throws serialisation_error if a field is too large for the layout.
+std::string SerialiseCompactFob(DataTagValue tag, const Identity& name,
+                                const asymm::EncodedPrivateKey& private_key,
+                                const asymm::EncodedPublicKey& public_key,
+                                const asymm::Signature& validation_token);
+
+// Reads the fields of a fob serialised in either format, without validating them.  Throws
+// parsing_error if the bytes are malformed.
+FobCereal ParseFobCereal(ByteView serialised);
+// Reads just the name of a fob serialised in either format, leaving its key fields in place.
+// Throws parsing_error if the bytes are malformed or the name is missing.
+Identity ReadFobName(ByteView serialised);
+
+// Throws serialisation_error if a field is too large for the layout.
+std::string SerialiseCompactPublicFob(DataTagValue tag, const asymm::EncodedPublicKey& public_key,
+                                      const asymm::Signature& validation_token);
+// As above, appending to 'serialised'.
+void AppendCompactPublicFob(DataTagValue tag, const asymm::EncodedPublicKey& public_key,
+                            const asymm::Signature& validation_token, std::string& serialised);
+
+// The fields of a compact public fob, as views into its serialised bytes.
+struct CompactPublicFobFields {
+  DataTagValue tag;
+  ByteView public_key;
+  ByteView validation_token;
+};
+
+// Checks the header of a compact public fob and locates its fields, without copying them.  Throws
+// parsing_error if the bytes are malformed.
+CompactPublicFobFields ReadCompactPublicFobFields(ByteView serialised);
+
+// Reads the fields of a compact public fob.  Throws parsing_error if the bytes are malformed or
+// its tag isn't 'tag'.
+void ParseCompactPublicFob(DataTagValue tag, ByteView serialised,
+                           asymm::EncodedPublicKey& public_key, asymm::Signature& validation_token);
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_COMPACT_FORMAT_H_
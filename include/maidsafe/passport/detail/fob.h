@@ -19,6 +19,7 @@
 #ifndef MAIDSAFE_PASSPORT_DETAIL_FOB_H_
 #define MAIDSAFE_PASSPORT_DETAIL_FOB_H_
 
+#include <memory>
 #include <type_traits>
 #include <string>
 #include <vector>
@@ -30,7 +31,12 @@
 #include "maidsafe/common/types.h"
 #include "maidsafe/common/serialisation/serialisation.h"
 
+#include "maidsafe/passport/detail/byte_view.h"
+#include "maidsafe/passport/detail/compact_format.h"
 #include "maidsafe/passport/detail/config.h"
+#include "maidsafe/passport/detail/fob_cereal.h"
+#include "maidsafe/passport/detail/key_pool.h"
+#include "maidsafe/passport/detail/serialisation_buffer.h"
 
 namespace maidsafe {
 
@@ -40,12 +46,88 @@ namespace detail {
 
 Identity CreateFobName(const asymm::PublicKey& public_key,
                        const asymm::Signature& validation_token);
+Identity CreateFobName(const asymm::EncodedPublicKey& encoded_public_key,
+                       const asymm::Signature& validation_token);
 
 Identity CreateMpidName(const NonEmptyString& chosen_name);
 
-void ValidateFobDeserialisation(DataTagValue enum_value, asymm::Keys& keys,
-                                asymm::Signature& validation_token, Identity& name,
-                                std::uint32_t type);
+// How a parsed fob's private key is shown to belong to its public key.
+enum class ValidationMode {
+  // Checks that both keys share modulus and public exponent and that the private key's CRT
+  // parameters are consistent with them.  Costs a few multi-precision multiplications.
+  kKeyConsistency,
+  // Encrypts random data with the public key and decrypts it with the private key.  Costs a full
+  // private-key operation.
+  kRoundTrip,
+  // Leaves the private key encoded.  It's decoded and checked as per kKeyConsistency on first use,
+  // which throws parsing_error if either fails.  Suits fobs which may never be used for signing.
+  kDeferred
+};
+
+bool KeysMatch(const asymm::Keys& keys);
+bool KeysMatch(const asymm::PrivateKey& private_key, const asymm::PublicKey& public_key);
+
+// A fob's key pair, with the encoding of its private key.  The private key may be held only in its
+// encoded form, in which case it's decoded on first use; decoding is thread-safe, and the decoded
+// key is shared by all copies made afterwards.
+class FobKeys {
+ public:
+  FobKeys();
+  // Encodes the private key.
+  explicit FobKeys(asymm::Keys keys);
+  // For keys validated as per 'mode'.  Unless 'mode' is kDeferred, 'keys.private_key' must be the
+  // decoded form of 'encoded_private_key'; otherwise it's ignored.
+  FobKeys(asymm::Keys keys, asymm::EncodedPrivateKey encoded_private_key, ValidationMode mode);
+  FobKeys(const FobKeys& other);
+  FobKeys(FobKeys&& other);
+  friend void swap(FobKeys& lhs, FobKeys& rhs);
+  FobKeys& operator=(FobKeys other);
+
+  const asymm::PublicKey& public_key() const { return public_key_; }
+  const asymm::EncodedPrivateKey& encoded_private_key() const { return encoded_private_key_; }
+  // Throws parsing_error if a deferred private key fails to decode or doesn't match the public key.
+  const asymm::PrivateKey& private_key() const;
+  bool private_key_decoded() const;
+
+ private:
+  asymm::PublicKey public_key_;
+  asymm::EncodedPrivateKey encoded_private_key_;
+  mutable std::shared_ptr<const asymm::PrivateKey> private_key_;
+};
+
+// Signs each of 'messages' with 'private_key', spread across 'thread_count' threads, where zero
+// means one per hardware core.  The signatures are in the order of 'messages'.
+std::vector<asymm::Signature> SignMessages(const asymm::PrivateKey& private_key,
+                                           const std::vector<asymm::PlainText>& messages,
+                                           unsigned thread_count);
+
+// Counts of parsed fobs accepted, and rejected at each validation stage, since process start.
+// 'round_trips' counts the key pairs checked as per ValidationMode::kRoundTrip, whether or not they
+// passed.
+struct ValidationStatistics {
+  std::uint64_t accepted;
+  std::uint64_t tag_rejects;
+  std::uint64_t encoding_rejects;
+  std::uint64_t name_rejects;
+  std::uint64_t key_rejects;
+  std::uint64_t round_trips;
+};
+
+ValidationStatistics GetValidationStatistics();
+
+// Validates the fields of a parsed fob and returns its decoded keys.  In kDeferred mode the private
+// key is neither decoded nor checked, and the returned one is empty.  The checks run in order of
+// increasing cost so that mistyped or corrupt input is rejected as cheaply as possible:
+//   1. tag - the serialised type must match 'enum_value'
+//   2. encoding - all fields present and within size bounds
+//   3. name - for non-Mpid types, the name must be the hash of the encoded public key and the
+//      validation token.  This hashes the received bytes, so needs no key decoding.
+//   4. keys - both keys are decoded, and the public key must re-encode to the received bytes
+//      (either failure counts as an encoding reject), then the private key is checked against the
+//      public key as per 'mode'.
+// Throws parsing_error on the first failed stage.
+asymm::Keys ValidateFobDeserialisation(DataTagValue enum_value, const FobCereal& fob_cereal,
+                                       ValidationMode mode);
 
 template <typename TagType>
 struct is_self_signed {
@@ -63,23 +145,25 @@ class Fob<TagType, typename std::enable_if<is_self_signed<TagType>::type::value>
   typedef TagType Tag;
 
   // This constructor is only available to this specialisation (i.e. self-signed fob).
-  Fob() : keys_(asymm::GenerateKeyPair()),
-      validation_token_(asymm::Sign(asymm::PlainText{ asymm::EncodeKey(keys_.public_key) },
-                                    keys_.private_key)),
-      name_(CreateFobName(keys_.public_key, validation_token_)) {
+  Fob() : keys_(KeyPool::Instance().Get()),
+      encoded_public_key_(asymm::EncodeKey(keys_.public_key())),
+      validation_token_(asymm::Sign(asymm::PlainText{ encoded_public_key_ }, keys_.private_key())),
+      name_(CreateFobName(encoded_public_key_, validation_token_)) {
     static_assert(std::is_same<Fob<Tag>, Signer>::value,
                   "This constructor is only applicable for self-signing fobs.");
   }
 
-  Fob(const Fob& other) : keys_(other.keys_), validation_token_(other.validation_token_),
-      name_(other.name_) {}
+  Fob(const Fob& other) : keys_(other.keys_), encoded_public_key_(other.encoded_public_key_),
+      validation_token_(other.validation_token_), name_(other.name_) {}
 
   Fob(Fob&& other) : keys_(std::move(other.keys_)),
+      encoded_public_key_(std::move(other.encoded_public_key_)),
       validation_token_(std::move(other.validation_token_)), name_(std::move(other.name_)) {}
 
   friend void swap(Fob& lhs, Fob& rhs) {
     using std::swap;
     swap(lhs.keys_, rhs.keys_);
+    swap(lhs.encoded_public_key_, rhs.encoded_public_key_);
     swap(lhs.validation_token_, rhs.validation_token_);
     swap(lhs.name_, rhs.name_);
   }
@@ -89,36 +173,58 @@ class Fob<TagType, typename std::enable_if<is_self_signed<TagType>::type::value>
     return *this;
   }
 
-  explicit Fob(const std::string& binary_stream) : keys_(), validation_token_(), name_() {
-    try {maidsafe::ConvertFromString(binary_stream, *this);}
+  explicit Fob(const std::string& binary_stream,
+               ValidationMode mode = ValidationMode::kKeyConsistency)
+      : Fob(ByteView(binary_stream), mode) {}
+
+  // Parses in place from bytes held elsewhere, e.g. in a receive buffer.  Accepts either format.
+  explicit Fob(ByteView binary_stream, ValidationMode mode = ValidationMode::kKeyConsistency)
+      : keys_(), encoded_public_key_(), validation_token_(), name_() {
+    try { FromCereal(ParseFobCereal(binary_stream), mode); }
     catch(...) {BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));}
   }
 
   std::string ToCereal() const {
     return maidsafe::ConvertToString(*this);
   }
+  // As ToCereal() for kV1.
+  std::string Serialise(WireFormat format) const {
+    if (format == WireFormat::kV1)
+      return ToCereal();
+    return SerialiseCompactFob(Tag::kValue, name_.value, keys_.encoded_private_key(),
+                               encoded_public_key_, validation_token_);
+  }
+  // Appends the bytes ToCereal() would return.
+  void SerialiseInto(SerialisationBuffer& buffer) const { buffer.Write(*this); }
 
   Name name() const { return name_; }
   asymm::Signature validation_token() const { return validation_token_; }
-  asymm::PrivateKey private_key() const { return keys_.private_key; }
-  asymm::PublicKey public_key() const { return keys_.public_key; }
+  // The private key accessors throw parsing_error if a deferred private key proves invalid.
+  asymm::PrivateKey private_key() const { return keys_.private_key(); }
+  asymm::PublicKey public_key() const { return keys_.public_key(); }
+  // Non-copying equivalents of the above, valid for the lifetime of this fob.
+  const Name& name_ref() const { return name_; }
+  const asymm::Signature& validation_token_ref() const { return validation_token_; }
+  const asymm::PrivateKey& private_key_ref() const { return keys_.private_key(); }
+  const asymm::PublicKey& public_key_ref() const { return keys_.public_key(); }
+  const asymm::EncodedPublicKey& encoded_public_key() const { return encoded_public_key_; }
+  bool private_key_decoded() const { return keys_.private_key_decoded(); }
+
+  // Sign with the fob's private key, decoded once and shared rather than copied per call.  Both
+  // throw as private_key_ref() does.
+  asymm::Signature Sign(const asymm::PlainText& message) const {
+    return asymm::Sign(message, keys_.private_key());
+  }
+  std::vector<asymm::Signature> SignBatch(const std::vector<asymm::PlainText>& messages,
+                                          unsigned thread_count = 0) const {
+    return SignMessages(keys_.private_key(), messages, thread_count);
+  }
 
   template<typename Archive>
   Archive& load(Archive& ref_archive) {
-    asymm::EncodedPrivateKey temp_private_key {};
-    asymm::EncodedPublicKey temp_public_key {};
-    std::uint32_t temp_type {};
-    Identity name;
-
-    auto& archive = ref_archive(temp_type, name, temp_private_key,
-                                temp_public_key, validation_token_);
-
-    keys_.private_key = asymm::DecodeKey(std::move(temp_private_key));
-    keys_.public_key = asymm::DecodeKey(std::move(temp_public_key));
-
-    ValidateFobDeserialisation(Tag::kValue, keys_, validation_token_, name, temp_type);
-    name_ = Name {std::move(name)};
-
+    FobCereal fob_cereal;
+    auto& archive = ref_archive(fob_cereal);
+    FromCereal(std::move(fob_cereal), ValidationMode::kKeyConsistency);
     return archive;
   }
 
@@ -126,13 +232,23 @@ class Fob<TagType, typename std::enable_if<is_self_signed<TagType>::type::value>
   Archive& save(Archive& ref_archive) const {
     return ref_archive(static_cast<uint32_t>(Tag::kValue),
                        name_->string(),
-                       asymm::EncodeKey(keys_.private_key).string(),
-                       asymm::EncodeKey(keys_.public_key).string(),
+                       keys_.encoded_private_key().string(),
+                       encoded_public_key_.string(),
                        validation_token_);
   }
 
  private:
-  asymm::Keys keys_;
+  void FromCereal(FobCereal fob_cereal, ValidationMode mode) {
+    asymm::Keys keys(ValidateFobDeserialisation(Tag::kValue, fob_cereal, mode));
+    keys_ = FobKeys{ std::move(keys), std::move(fob_cereal.private_key_), mode };
+    encoded_public_key_ = std::move(fob_cereal.public_key_);
+    validation_token_ = std::move(fob_cereal.validation_token_);
+    name_ = Name {std::move(fob_cereal.name_)};
+  }
+
+  FobKeys keys_;
+  // Canonical encoding of the public key, retained so serialising and naming needn't re-encode.
+  asymm::EncodedPublicKey encoded_public_key_;
   asymm::Signature validation_token_;
   Name name_;
 };
@@ -151,20 +267,23 @@ class Fob<TagType, typename std::enable_if<!is_self_signed<TagType>::type::value
   // This constructor is only available to this specialisation (i.e. non-self-signed fob)
   explicit Fob(const Signer& signing_fob,
                typename std::enable_if<!std::is_same<Fob<Tag>, Signer>::value>::type* = 0)
-      : keys_(asymm::GenerateKeyPair()),
-        validation_token_(asymm::Sign(asymm::PlainText{ asymm::EncodeKey(keys_.public_key) },
-                                      signing_fob.private_key())),
-        name_(CreateFobName(keys_.public_key, validation_token_)) {}
+      : keys_(KeyPool::Instance().Get()),
+        encoded_public_key_(asymm::EncodeKey(keys_.public_key())),
+        validation_token_(asymm::Sign(asymm::PlainText{ encoded_public_key_ },
+                                      signing_fob.private_key_ref())),
+        name_(CreateFobName(encoded_public_key_, validation_token_)) {}
 
-  Fob(const Fob& other) : keys_(other.keys_), validation_token_(other.validation_token_),
-      name_(other.name_) {}
+  Fob(const Fob& other) : keys_(other.keys_), encoded_public_key_(other.encoded_public_key_),
+      validation_token_(other.validation_token_), name_(other.name_) {}
 
   Fob(Fob&& other) : keys_(std::move(other.keys_)),
+      encoded_public_key_(std::move(other.encoded_public_key_)),
       validation_token_(std::move(other.validation_token_)), name_(std::move(other.name_)) {}
 
   friend void swap(Fob& lhs, Fob& rhs) {
     using std::swap;
     swap(lhs.keys_, rhs.keys_);
+    swap(lhs.encoded_public_key_, rhs.encoded_public_key_);
     swap(lhs.validation_token_, rhs.validation_token_);
     swap(lhs.name_, rhs.name_);
   }
@@ -174,36 +293,58 @@ class Fob<TagType, typename std::enable_if<!is_self_signed<TagType>::type::value
     return *this;
   }
 
-  explicit Fob(const std::string& binary_stream) : keys_(), validation_token_(), name_() {
-    try {maidsafe::ConvertFromString(binary_stream, *this);}
+  explicit Fob(const std::string& binary_stream,
+               ValidationMode mode = ValidationMode::kKeyConsistency)
+      : Fob(ByteView(binary_stream), mode) {}
+
+  // Parses in place from bytes held elsewhere, e.g. in a receive buffer.  Accepts either format.
+  explicit Fob(ByteView binary_stream, ValidationMode mode = ValidationMode::kKeyConsistency)
+      : keys_(), encoded_public_key_(), validation_token_(), name_() {
+    try { FromCereal(ParseFobCereal(binary_stream), mode); }
     catch(...) {BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));}
   }
 
   std::string ToCereal() const {
     return maidsafe::ConvertToString(*this);
   }
+  // As ToCereal() for kV1.
+  std::string Serialise(WireFormat format) const {
+    if (format == WireFormat::kV1)
+      return ToCereal();
+    return SerialiseCompactFob(Tag::kValue, name_.value, keys_.encoded_private_key(),
+                               encoded_public_key_, validation_token_);
+  }
+  // Appends the bytes ToCereal() would return.
+  void SerialiseInto(SerialisationBuffer& buffer) const { buffer.Write(*this); }
 
   Name name() const { return name_; }
   asymm::Signature validation_token() const { return validation_token_; }
-  asymm::PrivateKey private_key() const { return keys_.private_key; }
-  asymm::PublicKey public_key() const { return keys_.public_key; }
+  // The private key accessors throw parsing_error if a deferred private key proves invalid.
+  asymm::PrivateKey private_key() const { return keys_.private_key(); }
+  asymm::PublicKey public_key() const { return keys_.public_key(); }
+  // Non-copying equivalents of the above, valid for the lifetime of this fob.
+  const Name& name_ref() const { return name_; }
+  const asymm::Signature& validation_token_ref() const { return validation_token_; }
+  const asymm::PrivateKey& private_key_ref() const { return keys_.private_key(); }
+  const asymm::PublicKey& public_key_ref() const { return keys_.public_key(); }
+  const asymm::EncodedPublicKey& encoded_public_key() const { return encoded_public_key_; }
+  bool private_key_decoded() const { return keys_.private_key_decoded(); }
+
+  // Sign with the fob's private key, decoded once and shared rather than copied per call.  Both
+  // throw as private_key_ref() does.
+  asymm::Signature Sign(const asymm::PlainText& message) const {
+    return asymm::Sign(message, keys_.private_key());
+  }
+  std::vector<asymm::Signature> SignBatch(const std::vector<asymm::PlainText>& messages,
+                                          unsigned thread_count = 0) const {
+    return SignMessages(keys_.private_key(), messages, thread_count);
+  }
 
   template<typename Archive>
   Archive& load(Archive& ref_archive) {
-    asymm::EncodedPrivateKey temp_private_key {};
-    asymm::EncodedPublicKey temp_public_key {};
-    std::uint32_t temp_type {};
-    Identity name;
-
-    auto& archive = ref_archive(temp_type, name, temp_private_key,
-                                temp_public_key, validation_token_);
-
-    keys_.private_key = asymm::DecodeKey(std::move(temp_private_key));
-    keys_.public_key = asymm::DecodeKey(std::move(temp_public_key));
-
-    ValidateFobDeserialisation(Tag::kValue, keys_, validation_token_, name, temp_type);
-    name_ = Name {std::move(name)};
-
+    FobCereal fob_cereal;
+    auto& archive = ref_archive(fob_cereal);
+    FromCereal(std::move(fob_cereal), ValidationMode::kKeyConsistency);
     return archive;
   }
 
@@ -211,13 +352,23 @@ class Fob<TagType, typename std::enable_if<!is_self_signed<TagType>::type::value
   Archive& save(Archive& ref_archive) const {
     return ref_archive(static_cast<uint32_t>(Tag::kValue),
                        name_->string(),
-                       asymm::EncodeKey(keys_.private_key).string(),
-                       asymm::EncodeKey(keys_.public_key).string(),
+                       keys_.encoded_private_key().string(),
+                       encoded_public_key_.string(),
                        validation_token_);
   }
 
  private:
-  asymm::Keys keys_;
+  void FromCereal(FobCereal fob_cereal, ValidationMode mode) {
+    asymm::Keys keys(ValidateFobDeserialisation(Tag::kValue, fob_cereal, mode));
+    keys_ = FobKeys{ std::move(keys), std::move(fob_cereal.private_key_), mode };
+    encoded_public_key_ = std::move(fob_cereal.public_key_);
+    validation_token_ = std::move(fob_cereal.validation_token_);
+    name_ = Name {std::move(fob_cereal.name_)};
+  }
+
+  FobKeys keys_;
+  // Canonical encoding of the public key, retained so serialising and naming needn't re-encode.
+  asymm::EncodedPublicKey encoded_public_key_;
   asymm::Signature validation_token_;
   Name name_;
 };
@@ -241,35 +392,50 @@ class Fob<MpidTag> {
   friend void swap(Fob& lhs, Fob& rhs) {
     using std::swap;
     swap(lhs.keys_, rhs.keys_);
+    swap(lhs.encoded_public_key_, rhs.encoded_public_key_);
     swap(lhs.validation_token_, rhs.validation_token_);
     swap(lhs.name_, rhs.name_);
   }
   Fob& operator=(Fob other);
 
-  explicit Fob(const std::string& binary_stream);
+  explicit Fob(const std::string& binary_stream,
+               ValidationMode mode = ValidationMode::kKeyConsistency);
+  // Parses in place from bytes held elsewhere, e.g. in a receive buffer.  Accepts either format.
+  explicit Fob(ByteView binary_stream, ValidationMode mode = ValidationMode::kKeyConsistency);
   std::string ToCereal() const;
+  // As ToCereal() for kV1.
+  std::string Serialise(WireFormat format) const;
+  // Appends the bytes ToCereal() would return.
+  void SerialiseInto(SerialisationBuffer& buffer) const { buffer.Write(*this); }
 
   Name name() const { return name_; }
   asymm::Signature validation_token() const { return validation_token_; }
-  asymm::PrivateKey private_key() const { return keys_.private_key; }
-  asymm::PublicKey public_key() const { return keys_.public_key; }
+  // The private key accessors throw parsing_error if a deferred private key proves invalid.
+  asymm::PrivateKey private_key() const { return keys_.private_key(); }
+  asymm::PublicKey public_key() const { return keys_.public_key(); }
+  // Non-copying equivalents of the above, valid for the lifetime of this fob.
+  const Name& name_ref() const { return name_; }
+  const asymm::Signature& validation_token_ref() const { return validation_token_; }
+  const asymm::PrivateKey& private_key_ref() const { return keys_.private_key(); }
+  const asymm::PublicKey& public_key_ref() const { return keys_.public_key(); }
+  const asymm::EncodedPublicKey& encoded_public_key() const { return encoded_public_key_; }
+  bool private_key_decoded() const { return keys_.private_key_decoded(); }
+
+  // Sign with the fob's private key, decoded once and shared rather than copied per call.  Both
+  // throw as private_key_ref() does.
+  asymm::Signature Sign(const asymm::PlainText& message) const {
+    return asymm::Sign(message, keys_.private_key());
+  }
+  std::vector<asymm::Signature> SignBatch(const std::vector<asymm::PlainText>& messages,
+                                          unsigned thread_count = 0) const {
+    return SignMessages(keys_.private_key(), messages, thread_count);
+  }
 
   template<typename Archive>
   Archive& load(Archive& ref_archive) {
-    asymm::EncodedPrivateKey temp_private_key {};
-    asymm::EncodedPublicKey temp_public_key {};
-    std::uint32_t temp_type {};
-    Identity name;
-
-    auto& archive = ref_archive(temp_type, name, temp_private_key,
-                                temp_public_key, validation_token_);
-
-    keys_.private_key = asymm::DecodeKey(std::move(temp_private_key));
-    keys_.public_key = asymm::DecodeKey(std::move(temp_public_key));
-
-    ValidateFobDeserialisation(Tag::kValue, keys_, validation_token_, name, temp_type);
-    name_ = Name {std::move(name)};
-
+    FobCereal fob_cereal;
+    auto& archive = ref_archive(fob_cereal);
+    FromCereal(std::move(fob_cereal), ValidationMode::kKeyConsistency);
     return archive;
   }
 
@@ -277,13 +443,23 @@ class Fob<MpidTag> {
   Archive& save(Archive& ref_archive) const {
     return ref_archive(static_cast<uint32_t>(Tag::kValue),
                        name_->string(),
-                       asymm::EncodeKey(keys_.private_key).string(),
-                       asymm::EncodeKey(keys_.public_key).string(),
+                       keys_.encoded_private_key().string(),
+                       encoded_public_key_.string(),
                        validation_token_);
   }
 
  private:
-  asymm::Keys keys_;
+  void FromCereal(FobCereal fob_cereal, ValidationMode mode) {
+    asymm::Keys keys(ValidateFobDeserialisation(Tag::kValue, fob_cereal, mode));
+    keys_ = FobKeys{ std::move(keys), std::move(fob_cereal.private_key_), mode };
+    encoded_public_key_ = std::move(fob_cereal.public_key_);
+    validation_token_ = std::move(fob_cereal.validation_token_);
+    name_ = Name {std::move(fob_cereal.name_)};
+  }
+
+  FobKeys keys_;
+  // Canonical encoding of the public key, retained so serialising and naming needn't re-encode.
+  asymm::EncodedPublicKey encoded_public_key_;
   asymm::Signature validation_token_;
   Name name_;
 };
@@ -0,0 +1,161 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_FOB_CACHE_H_
+#define MAIDSAFE_PASSPORT_DETAIL_FOB_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "maidsafe/common/crypto.h"
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/passport/detail/fob.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+struct FobCacheStatistics {
+  std::uint64_t hits;
+  std::uint64_t misses;
+  std::size_t entry_count;
+  std::size_t memory_usage;
+};
+
+// A bounded, thread-safe cache of parsed and validated fobs or public fobs, keyed by the SHA-512
+// digest of their serialised form and, for fobs, the validation mode.  Parsing bytes which have
+// been parsed before costs a hash and a lookup, and yields the same immutable instance.  Input
+// which fails to parse is never cached.
+//
+// Memory use is approximate: each entry is charged twice the size of its serialised form, which
+// covers the decoded keys held by the instance.  Least recently used entries are evicted to stay
+// within the limit.
+template <typename FobType>
+class FobCache {
+ public:
+  typedef std::shared_ptr<const FobType> FobPtr;
+  typedef FobCacheStatistics Statistics;
+
+  explicit FobCache(std::size_t memory_limit)
+      : memory_limit_(memory_limit), memory_usage_(0), entries_(), index_(), statistics_(),
+        mutex_() {}
+
+  // For Fob types.  Throws as the equivalent Fob constructor does.  Entries are cached per 'mode',
+  // so a hit has always been validated as the caller asked.
+  FobPtr Parse(const std::string& binary_stream,
+               ValidationMode mode = ValidationMode::kKeyConsistency) {
+    return Get(binary_stream + static_cast<char>(mode), binary_stream.size(),
+               [&] { return std::make_shared<const FobType>(binary_stream, mode); });
+  }
+
+  // For PublicFob types.  Throws as the equivalent PublicFob constructor does.
+  template <typename SerialisedType>
+  FobPtr Parse(const typename FobType::Name& name, const SerialisedType& serialised_public_fob) {
+    if (!name->IsInitialised() || !serialised_public_fob.data.IsInitialised())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    const std::string& serialised(serialised_public_fob.data.string());
+    return Get(name->string() + serialised, serialised.size(),
+               [&] { return std::make_shared<const FobType>(name, serialised_public_fob); });
+  }
+
+  Statistics GetStatistics() const {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    Statistics statistics(statistics_);
+    statistics.entry_count = entries_.size();
+    statistics.memory_usage = memory_usage_;
+    return statistics;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    entries_.clear();
+    index_.clear();
+    memory_usage_ = 0;
+  }
+
+ private:
+  struct Entry {
+    Entry(std::string digest_in, FobPtr fob_in, std::size_t cost_in)
+        : digest(std::move(digest_in)), fob(std::move(fob_in)), cost(cost_in) {}
+    std::string digest;
+    FobPtr fob;
+    std::size_t cost;
+  };
+  typedef std::list<Entry> Entries;
+
+  FobCache(const FobCache&) = delete;
+  FobCache(FobCache&&) = delete;
+  FobCache& operator=(FobCache) = delete;
+
+  template <typename Construct>
+  FobPtr Get(const std::string& key, std::size_t serialised_size, const Construct& construct) {
+    std::string digest(crypto::Hash<crypto::SHA512>(key).string());
+    {
+      std::lock_guard<std::mutex> lock{ mutex_ };
+      auto itr(index_.find(digest));
+      if (itr != std::end(index_)) {
+        ++statistics_.hits;
+        entries_.splice(std::begin(entries_), entries_, itr->second);
+        return itr->second->fob;
+      }
+      ++statistics_.misses;
+    }
+
+    // Parse without holding the lock so that concurrent misses don't serialise.
+    FobPtr fob(construct());
+    const std::size_t cost(2 * serialised_size + digest.size());
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto itr(index_.find(digest));
+    if (itr != std::end(index_))
+      return itr->second->fob;
+    if (cost > memory_limit_)
+      return fob;
+    while (memory_usage_ + cost > memory_limit_) {
+      memory_usage_ -= entries_.back().cost;
+      index_.erase(entries_.back().digest);
+      entries_.pop_back();
+    }
+    entries_.emplace_front(digest, fob, cost);
+    index_.emplace(std::move(digest), std::begin(entries_));
+    memory_usage_ += cost;
+    return fob;
+  }
+
+  const std::size_t memory_limit_;
+  std::size_t memory_usage_;
+  Entries entries_;
+  std::unordered_map<std::string, typename Entries::iterator> index_;
+  Statistics statistics_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_FOB_CACHE_H_
@@ -0,0 +1,114 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_KEY_POOL_H_
+#define MAIDSAFE_PASSPORT_DETAIL_KEY_POOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/rsa.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// Pre-generates RSA key pairs on background threads so that constructing a Fob normally costs a
+// queue pop rather than a full key generation.  The number of pairs held is kept between the low
+// and high watermarks, scaled by the recent rate at which pairs have been taken.  If the pool is
+// empty when a pair is requested, the request is treated as urgent: the pair is generated on the
+// calling thread and background refilling is paused until it completes.
+class KeyPool {
+ public:
+  struct Config {
+    Config() : low_watermark(2), high_watermark(16), thread_count(1) {}
+    Config(std::size_t low_watermark_in, std::size_t high_watermark_in, unsigned thread_count_in)
+        : low_watermark(low_watermark_in), high_watermark(high_watermark_in),
+          thread_count(thread_count_in) {}
+    std::size_t low_watermark;
+    std::size_t high_watermark;
+    // Number of background generator threads.  Zero disables pre-generation entirely.
+    unsigned thread_count;
+  };
+
+  struct Statistics {
+    std::uint64_t served_from_pool;
+    std::uint64_t generated_on_demand;
+  };
+
+  // The process-wide pool used by all Fob constructors.  Its worker threads are started lazily on
+  // the first request for a key pair.
+  static KeyPool& Instance();
+
+  explicit KeyPool(Config config = Config());
+  ~KeyPool();
+
+  // Returns a pre-generated key pair if one is available, otherwise generates one on the calling
+  // thread.  Throws only if key generation itself throws.
+  asymm::Keys Get();
+
+  // Throws if 'config.low_watermark' exceeds 'config.high_watermark'.  Surplus pairs above the new
+  // high watermark are discarded.
+  void Configure(Config config);
+  Config GetConfig() const;
+
+  // Number of pre-generated pairs currently held.
+  std::size_t Size() const;
+  Statistics GetStatistics() const;
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  KeyPool(const KeyPool&) = delete;
+  KeyPool(KeyPool&&) = delete;
+  KeyPool& operator=(KeyPool) = delete;
+
+  void StartWorkers();
+  void StopWorkers(std::unique_lock<std::mutex>& lock);
+  void Run();
+  void RecordDemand(Clock::time_point now);
+  double DemandRate(Clock::time_point now) const;
+  std::size_t Target(Clock::time_point now) const;
+
+  Config config_;
+  std::deque<asymm::Keys> keys_;
+  std::vector<std::thread> workers_;
+  std::size_t in_progress_, urgent_in_progress_;
+  double demand_rate_;
+  Clock::time_point last_demand_;
+  Statistics statistics_;
+  bool started_, stop_;
+  mutable std::mutex mutex_;
+  std::mutex configure_mutex_;
+  std::condition_variable condition_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_KEY_POOL_H_
@@ -0,0 +1,360 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_KEYS_AND_SIGNERS_H_
+#define MAIDSAFE_PASSPORT_DETAIL_KEYS_AND_SIGNERS_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "boost/iterator/iterator_facade.hpp"
+#include "boost/iterator/transform_iterator.hpp"
+#include "boost/optional/optional.hpp"
+
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/passport/detail/compact_format.h"
+#include "maidsafe/passport/detail/fob.h"
+#include "maidsafe/passport/detail/persistent_containers.h"
+#include "maidsafe/passport/detail/serialisation_buffer.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// An insertion-ordered collection of key and signer pairs, indexed by key name and by signer name.
+// Copying is constant time: copies share their contents, so a copy-on-write snapshot costs only
+// the nodes a mutation touches.  Collections of up to kIndexThreshold slots, as most passports'
+// are, keep no indices and are searched linearly, which at that size is faster than hashing and
+// walking the indices' tries; larger ones are indexed, making adding, finding and removing
+// O(log N) with a branching factor of 32.  A single collection isn't thread-safe, but distinct
+// copies and the entries themselves may be used concurrently.
+//
+// An entry may be added in serialised form, in which case only the names are read up front; the
+// fobs are decoded and validated, as per the modes given when adding it, on first access, and the
+// entry re-serialises to its original bytes without ever being decoded if it isn't accessed.
+template <typename Key>
+class KeysAndSigners {
+ public:
+  typedef std::pair<Key, typename Key::Signer> value_type;
+
+  class Entry {
+   public:
+    explicit Entry(value_type key_and_signer)
+        : serialised_key_(),
+          serialised_signer_(),
+          key_name_(),
+          signer_name_(),
+          key_validation_(ValidationMode::kKeyConsistency),
+          signer_validation_(ValidationMode::kKeyConsistency),
+          decoded_(std::move(key_and_signer)),
+          is_decoded_(true),
+          mutex_(),
+          key_prefix_(NamePrefix(key_name())),
+          signer_prefix_(NamePrefix(signer_name())) {}
+
+    // Throws parsing_error if the names can't be read.
+    Entry(std::string serialised_key, std::string serialised_signer, ValidationMode key_validation,
+          ValidationMode signer_validation)
+        : serialised_key_(std::move(serialised_key)),
+          serialised_signer_(std::move(serialised_signer)),
+          key_name_(ReadName(serialised_key_)),
+          signer_name_(ReadName(serialised_signer_)),
+          key_validation_(key_validation),
+          signer_validation_(signer_validation),
+          decoded_(),
+          is_decoded_(false),
+          mutex_(),
+          key_prefix_(NamePrefix(key_name_)),
+          signer_prefix_(NamePrefix(signer_name_)) {}
+
+    // Decodes and validates the fobs on first call.  Throws parsing_error (on this and every
+    // subsequent call) if they're invalid or don't have the names read up front.
+    const value_type& Get() const {
+      if (!is_decoded_.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock{ mutex_ };
+        if (!decoded_) {
+          value_type decoded(Key{ serialised_key_, key_validation_ },
+                             typename Key::Signer{ serialised_signer_, signer_validation_ });
+          if (decoded.first.name_ref()->string() != key_name_ ||
+              decoded.second.name_ref()->string() != signer_name_) {
+            BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+          }
+          decoded_ = std::move(decoded);
+        }
+        is_decoded_.store(true, std::memory_order_release);
+      }
+      return *decoded_;
+    }
+
+    // Write the serialised key or signer to 'buffer' as a string field, without building it first.
+    void WriteKey(SerialisationBuffer& buffer) const {
+      WriteFob(buffer, serialised_key_, [this] { return &Get().first; });
+    }
+    void WriteSigner(SerialisationBuffer& buffer) const {
+      WriteFob(buffer, serialised_signer_, [this] { return &Get().second; });
+    }
+
+    // An entry added decoded reads its names from the fobs rather than holding copies.
+    const std::string& key_name() const {
+      return serialised_key_.empty() ? decoded_->first.name_ref()->string() : key_name_;
+    }
+    const std::string& signer_name() const {
+      return serialised_key_.empty() ? decoded_->second.name_ref()->string() : signer_name_;
+    }
+    bool decoded() const { return is_decoded_.load(std::memory_order_acquire); }
+
+    // Names are digests, so their leading bytes tell almost all of them apart.  Comparing those
+    // first lets a scan skip non-matching entries without reaching their names.
+    static std::uint64_t NamePrefix(const std::string& name) {
+      std::uint64_t prefix(0);
+      std::memcpy(&prefix, name.data(), std::min(name.size(), sizeof(prefix)));
+      return prefix;
+    }
+    bool HasKeyName(const std::string& name, std::uint64_t prefix) const {
+      return key_prefix_ == prefix && key_name() == name;
+    }
+    bool HasSignerName(const std::string& name, std::uint64_t prefix) const {
+      return signer_prefix_ == prefix && signer_name() == name;
+    }
+
+   private:
+    Entry(const Entry&) = delete;
+    Entry(Entry&&) = delete;
+    Entry& operator=(Entry) = delete;
+
+    template <typename GetFob>
+    static void WriteFob(SerialisationBuffer& buffer, const std::string& serialised_fob,
+                         const GetFob& get_fob) {
+      if (serialised_fob.empty())
+        buffer.WriteString([&](SerialisationBuffer&) { get_fob()->SerialiseInto(buffer); });
+      else
+        buffer.Write(serialised_fob);
+    }
+
+    static std::string ReadName(const std::string& serialised_fob) {
+      return ReadFobName(ByteView(serialised_fob)).string();
+    }
+
+    const std::string serialised_key_, serialised_signer_;
+    const std::string key_name_, signer_name_;
+    const ValidationMode key_validation_, signer_validation_;
+    // Held in place, so an entry costs a single allocation.
+    mutable boost::optional<value_type> decoded_;
+    mutable std::atomic<bool> is_decoded_;
+    mutable std::mutex mutex_;
+    const std::uint64_t key_prefix_, signer_prefix_;
+  };
+
+ private:
+  typedef std::shared_ptr<const Entry> EntryPtr;
+  struct GetKey {
+    typedef const Key& result_type;
+    const Key& operator()(const Entry& entry) const { return entry.Get().first; }
+  };
+
+ public:
+  // Visits entries in insertion order.  An iterator holds its own reference to the contents it was
+  // taken from, so stays valid after the collection is modified or destroyed.
+  class const_iterator : public boost::iterator_facade<const_iterator, const Entry,
+                                                       boost::forward_traversal_tag> {
+   public:
+    const_iterator() : entries_(), index_(0) {}
+
+   private:
+    friend class KeysAndSigners;
+    friend class boost::iterator_core_access;
+
+    const_iterator(PersistentVector<EntryPtr> entries, std::size_t index)
+        : entries_(std::move(entries)), index_(index) {
+      SkipRemoved();
+    }
+
+    void SkipRemoved() {
+      while (index_ < entries_.size() && !entries_[index_])
+        ++index_;
+    }
+    void increment() {
+      ++index_;
+      SkipRemoved();
+    }
+    bool equal(const const_iterator& other) const { return index_ == other.index_; }
+    const Entry& dereference() const { return *entries_[index_]; }
+
+    PersistentVector<EntryPtr> entries_;
+    std::size_t index_;
+  };
+  // Dereferencing decodes the entry if necessary, so may throw.
+  typedef boost::transform_iterator<GetKey, const_iterator> const_key_iterator;
+
+  static const std::size_t kIndexThreshold = 128;
+
+  KeysAndSigners() : entries_(), key_index_(), signer_index_(), size_(0), indexed_(false) {}
+
+  // Constant time: the copy shares this collection's contents, and adding to or removing from
+  // either copies only the affected O(log N) nodes.
+  KeysAndSigners(const KeysAndSigners& other)
+      : entries_(other.entries_),
+        key_index_(other.key_index_),
+        signer_index_(other.signer_index_),
+        size_(other.size_),
+        indexed_(other.indexed_) {}
+
+  KeysAndSigners& operator=(const KeysAndSigners& other) {
+    entries_ = other.entries_;
+    key_index_ = other.key_index_;
+    signer_index_ = other.signer_index_;
+    size_ = other.size_;
+    indexed_ = other.indexed_;
+    return *this;
+  }
+
+  // Appends 'key_and_signer' and returns true, unless its key name or its signer name is already
+  // held, in which case returns false and leaves 'key_and_signer' untouched.
+  bool Add(value_type&& key_and_signer) {
+    if (Contains(key_and_signer.first.name_ref()->string(),
+                 key_and_signer.second.name_ref()->string())) {
+      return false;
+    }
+    Append(std::make_shared<const Entry>(std::move(key_and_signer)));
+    return true;
+  }
+
+  // As above, for a pair in serialised form, which is validated as per 'key_validation' and
+  // 'signer_validation' on first access.  Throws parsing_error if the names can't be read.
+  bool AddSerialised(std::string serialised_key, std::string serialised_signer,
+                     ValidationMode key_validation = ValidationMode::kKeyConsistency,
+                     ValidationMode signer_validation = ValidationMode::kKeyConsistency) {
+    auto entry(std::make_shared<const Entry>(std::move(serialised_key),
+                                             std::move(serialised_signer), key_validation,
+                                             signer_validation));
+    if (Contains(entry->key_name(), entry->signer_name()))
+      return false;
+    Append(std::move(entry));
+    return true;
+  }
+
+  // Returns end() if no key called 'key_name' is held.
+  const_iterator Find(const typename Key::Name& key_name) const {
+    if (!indexed_)
+      return const_iterator(entries_, Scan(key_name->string(), nullptr));
+    const std::size_t* index(key_index_.Find(key_name->string()));
+    return index ? const_iterator(entries_, *index) : end();
+  }
+
+  // Removes the entry at 'position', which must be dereferenceable.  'position' may also come from
+  // a copy of this collection, provided neither has been modified since the copy was made.
+  void Remove(const_iterator position) {
+    if (indexed_) {
+      key_index_.Erase(position->key_name());
+      signer_index_.Erase(position->signer_name());
+    }
+    // Drop the iterator's reference first, so that unless the caller holds another, the slot is
+    // reset in place rather than its path being copied.
+    const std::size_t index(position.index_);
+    position = const_iterator();
+    entries_.Reset(index);
+    --size_;
+    // Rebuilding once removed slots outnumber the live entries keeps iteration linear in size() at
+    // an amortised constant cost per removal.
+    if (entries_.size() > 2 * size_ + 32)
+      Compact();
+  }
+
+  void Clear() { *this = KeysAndSigners(); }
+
+  const_iterator begin() const { return const_iterator(entries_, 0); }
+  const_iterator end() const { return const_iterator(entries_, entries_.size()); }
+  const_key_iterator keys_begin() const { return const_key_iterator(begin(), GetKey()); }
+  const_key_iterator keys_end() const { return const_key_iterator(end(), GetKey()); }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+ private:
+  bool Contains(const std::string& key_name, const std::string& signer_name) const {
+    if (!indexed_)
+      return Scan(key_name, &signer_name) != entries_.size();
+    return key_index_.Find(key_name) != nullptr || signer_index_.Find(signer_name) != nullptr;
+  }
+
+  // Returns the slot of the entry with 'key_name', or if 'signer_name' is non-null, of the first
+  // with either name; returns entries_.size() if there's none.
+  std::size_t Scan(const std::string& key_name, const std::string* signer_name) const {
+    const std::uint64_t key_prefix(Entry::NamePrefix(key_name));
+    const std::uint64_t signer_prefix(signer_name ? Entry::NamePrefix(*signer_name) : 0);
+    for (std::size_t index(0); index != entries_.size(); ++index) {
+      const EntryPtr& entry(entries_[index]);
+      if (entry && (entry->HasKeyName(key_name, key_prefix) ||
+                    (signer_name && entry->HasSignerName(*signer_name, signer_prefix)))) {
+        return index;
+      }
+    }
+    return entries_.size();
+  }
+
+  // Both indices map a name to the entry's slot in 'entries_'.  They're built once the slots
+  // outnumber kIndexThreshold.
+  void Append(EntryPtr entry) {
+    const std::size_t index(entries_.size());
+    if (indexed_) {
+      key_index_.Insert(entry->key_name(), index);
+      signer_index_.Insert(entry->signer_name(), index);
+    }
+    entries_.PushBack(std::move(entry));
+    ++size_;
+    if (!indexed_ && entries_.size() > kIndexThreshold) {
+      for (std::size_t slot(0); slot != entries_.size(); ++slot) {
+        if (entries_[slot]) {
+          key_index_.Insert(entries_[slot]->key_name(), slot);
+          signer_index_.Insert(entries_[slot]->signer_name(), slot);
+        }
+      }
+      indexed_ = true;
+    }
+  }
+
+  void Compact() {
+    KeysAndSigners compacted;
+    for (std::size_t index(0); index != entries_.size(); ++index) {
+      if (entries_[index])
+        compacted.Append(entries_[index]);
+    }
+    *this = compacted;
+  }
+
+  PersistentVector<EntryPtr> entries_;
+  PersistentHashMap<std::size_t> key_index_, signer_index_;
+  std::size_t size_;
+  bool indexed_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_KEYS_AND_SIGNERS_H_
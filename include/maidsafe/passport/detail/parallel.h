@@ -0,0 +1,162 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_PARALLEL_H_
+#define MAIDSAFE_PASSPORT_DETAIL_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// Returns the number of threads to use for 'item_count' items when 'requested' threads were asked
+// for.  A request of zero means one thread per hardware core.
+inline unsigned WorkerCount(unsigned requested, std::size_t item_count) {
+  if (requested == 0)
+    requested = std::max(1U, std::thread::hardware_concurrency());
+  return static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(requested,
+                                                                               item_count)));
+}
+
+// A process-wide set of worker threads for ParallelFor, so that each call hands its work to threads
+// which already exist rather than starting its own.  The workers are started lazily on the first
+// task posted.
+class ThreadPool {
+ public:
+  static ThreadPool& Instance();
+
+  // A 'thread_count' of zero means one thread per hardware core.
+  explicit ThreadPool(unsigned thread_count = 0);
+  ~ThreadPool();
+
+  // Queues 'task' to run on a worker.  'task' shouldn't throw; if it does, the exception is logged
+  // and dropped.
+  void Post(std::function<void()> task);
+
+  // Waits for tasks already running to finish, then restarts with 'thread_count' workers (zero
+  // means one per hardware core).  Queued tasks are kept.  Throws invalid_argument if called from
+  // a task running on this pool.
+  void Configure(unsigned thread_count);
+  unsigned GetThreadCount() const;
+
+ private:
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool(ThreadPool&&) = delete;
+  ThreadPool& operator=(ThreadPool) = delete;
+
+  void StartWorkers();
+  void StopWorkers(std::unique_lock<std::mutex>& lock);
+  void Run();
+
+  unsigned thread_count_;
+  std::deque<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  bool started_, stop_;
+  mutable std::mutex mutex_;
+  std::mutex configure_mutex_;
+  std::condition_variable condition_;
+};
+
+// Shares one loop between its caller and helper tasks posted to the ThreadPool.  A helper which
+// starts after the caller has finished the loop does nothing, so the caller never waits on tasks
+// queued behind others, and nested loops can't deadlock.
+class LoopHelpers {
+ public:
+  explicit LoopHelpers(std::function<void()> loop);
+
+  // Runs the loop, unless Close() has already been called.
+  void Help();
+  // Called by the loop's owner once its own run of the loop has returned.  Waits for helpers
+  // already running the loop to return, and stops any others from starting it.
+  void Close();
+
+ private:
+  LoopHelpers(const LoopHelpers&) = delete;
+  LoopHelpers(LoopHelpers&&) = delete;
+  LoopHelpers& operator=(LoopHelpers) = delete;
+
+  const std::function<void()> loop_;
+  std::size_t running_;
+  bool closed_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+// Calls 'functor(index)' for every index in [0, item_count), spread across up to 'thread_count'
+// threads including the calling one; the others are ThreadPool workers.  If any call throws,
+// indices above the failing one may be skipped and the exception from the lowest failing index is
+// rethrown once all threads are done, so the reported error doesn't depend on scheduling.
+template <typename Functor>
+void ParallelFor(std::size_t item_count, unsigned thread_count, const Functor& functor) {
+  std::atomic<std::size_t> next_index(0);
+  std::atomic<std::size_t> first_failed_index(std::numeric_limits<std::size_t>::max());
+  std::exception_ptr first_exception;
+  std::mutex mutex;
+
+  auto worker([&] {
+    for (std::size_t index(next_index++); index < item_count; index = next_index++) {
+      if (index > first_failed_index)
+        continue;
+      try {
+        functor(index);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        if (index < first_failed_index) {
+          first_failed_index = index;
+          first_exception = std::current_exception();
+        }
+      }
+    }
+  });
+
+  const unsigned worker_count(WorkerCount(thread_count, item_count));
+  if (worker_count == 1) {
+    worker();
+  } else {
+    auto helpers(std::make_shared<LoopHelpers>(worker));
+    for (unsigned i(1); i < worker_count; ++i)
+      ThreadPool::Instance().Post([helpers] { helpers->Help(); });
+    worker();
+    helpers->Close();
+  }
+
+  if (first_exception)
+    std::rethrow_exception(first_exception);
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_PARALLEL_H_
@@ -0,0 +1,275 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_PERSISTENT_CONTAINERS_H_
+#define MAIDSAFE_PASSPORT_DETAIL_PERSISTENT_CONTAINERS_H_
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// The containers below share structure between copies: copying is constant time, and modifying a
+// container copies only the nodes on the path to the change which another copy shares, leaving
+// every other copy untouched.  A node held by one container alone is modified in place, so a
+// container which isn't being copied costs no more allocations than a conventional one.  A shared
+// node is never modified, so distinct copies may be used on different threads.
+
+// A sequence of slots, indexed from zero, which can be appended to and any of which can be reset to
+// T().  Reading, appending and resetting a slot are O(log N) with a branching factor of 32.
+template <typename T>
+class PersistentVector {
+ public:
+  PersistentVector() : root_(), height_(0), size_(0) {}
+
+  // Includes slots which have been reset.
+  std::size_t size() const { return size_; }
+
+  void PushBack(T value) {
+    if (size_ == (kWidth << (kBits * height_))) {
+      auto root(std::make_shared<Node>());
+      root->children.push_back(std::move(root_));
+      root_ = std::move(root);
+      ++height_;
+    }
+    Set(root_, height_, size_, std::move(value));
+    ++size_;
+  }
+
+  // 'index' must be less than size().
+  void Reset(std::size_t index) { Set(root_, height_, index, T()); }
+
+  // 'index' must be less than size().
+  const T& operator[](std::size_t index) const {
+    const Node* node(root_.get());
+    for (unsigned level(height_); level != 0; --level)
+      node = node->children[(index >> (kBits * level)) & kMask].get();
+    return node->values[index & kMask];
+  }
+
+ private:
+  static const unsigned kBits = 5;
+  static const std::size_t kWidth = 1U << kBits;
+  static const std::size_t kMask = kWidth - 1;
+
+  struct Node {
+    std::vector<std::shared_ptr<const Node>> children;
+    std::vector<T> values;
+  };
+
+  static void Set(std::shared_ptr<const Node>& node, unsigned level, std::size_t index, T value) {
+    Node* const writable(Writable(node));
+    const std::size_t slot((index >> (kBits * level)) & kMask);
+    if (level == 0) {
+      if (writable->values.size() <= slot) {
+        writable->values.reserve(kWidth);
+        writable->values.resize(slot + 1);
+      }
+      writable->values[slot] = std::move(value);
+    } else {
+      if (writable->children.size() <= slot)
+        writable->children.resize(slot + 1);
+      Set(writable->children[slot], level - 1, index, std::move(value));
+    }
+  }
+
+  // Nodes are only ever created non-const, so once 'node' is unshared it may be modified.  The
+  // fence orders the modification after any use by a copy which has since released the node.
+  static Node* Writable(std::shared_ptr<const Node>& node) {
+    if (!node)
+      node = std::make_shared<Node>();
+    else if (node.use_count() != 1)
+      node = std::make_shared<Node>(*node);
+    else
+      std::atomic_thread_fence(std::memory_order_acquire);
+    return const_cast<Node*>(node.get());
+  }
+
+  std::shared_ptr<const Node> root_;
+  unsigned height_;
+  std::size_t size_;
+};
+
+// A map from strings to values, held as a hash array mapped trie.  Finding, inserting and erasing
+// are O(log N) with a branching factor of 32; keys whose hashes fully collide share a chain.
+template <typename Value>
+class PersistentHashMap {
+ public:
+  PersistentHashMap() : root_(), size_(0) {}
+
+  // Returns nullptr if 'key' isn't held.  The value lives as long as any copy of the map holding
+  // it.
+  const Value* Find(const std::string& key) const {
+    const std::size_t hash(std::hash<std::string>()(key));
+    const Node* node(root_.get());
+    for (unsigned shift(0); node; shift += kBits) {
+      const std::uint32_t bit(Bit(hash, shift));
+      if ((node->bitmap & bit) == 0)
+        return nullptr;
+      const Slot& slot(node->slots[Position(node->bitmap, bit)]);
+      if (!slot.child) {
+        for (const Leaf* leaf(slot.leaf.get()); leaf; leaf = leaf->next.get()) {
+          if (leaf->hash == hash && leaf->key == key)
+            return &leaf->value;
+        }
+        return nullptr;
+      }
+      node = slot.child.get();
+    }
+    return nullptr;
+  }
+
+  // Returns false, leaving the map unchanged, if 'key' is already held.
+  bool Insert(const std::string& key, Value value) {
+    if (Find(key))
+      return false;
+    Insert(root_, 0, std::make_shared<const Leaf>(std::hash<std::string>()(key), key,
+                                                  std::move(value), nullptr));
+    ++size_;
+    return true;
+  }
+
+  // Returns false if 'key' isn't held.
+  bool Erase(const std::string& key) {
+    if (!Find(key))
+      return false;
+    Erase(root_, 0, std::hash<std::string>()(key), key);
+    --size_;
+    return true;
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  static const unsigned kBits = 5;
+
+  struct Leaf {
+    Leaf(std::size_t hash_in, std::string key_in, Value value_in,
+         std::shared_ptr<const Leaf> next_in)
+        : hash(hash_in),
+          key(std::move(key_in)),
+          value(std::move(value_in)),
+          next(std::move(next_in)) {}
+    const std::size_t hash;
+    const std::string key;
+    const Value value;
+    const std::shared_ptr<const Leaf> next;
+  };
+  struct Node;
+  // Holds either a child node or a chain of leaves with identical hashes.
+  struct Slot {
+    std::shared_ptr<const Node> child;
+    std::shared_ptr<const Leaf> leaf;
+  };
+  struct Node {
+    Node() : bitmap(0), slots() {}
+    std::uint32_t bitmap;
+    std::vector<Slot> slots;
+  };
+
+  // Two distinct hashes always differ in some bit examined before 'shift' passes their width.
+  static std::uint32_t Bit(std::size_t hash, unsigned shift) {
+    return std::uint32_t(1) << ((hash >> shift) & 31);
+  }
+  static std::size_t Position(std::uint32_t bitmap, std::uint32_t bit) {
+    return std::bitset<32>(bitmap & (bit - 1)).count();
+  }
+
+  static void Insert(std::shared_ptr<const Node>& node, unsigned shift,
+                     std::shared_ptr<const Leaf> leaf) {
+    Node* const writable(Writable(node));
+    const std::uint32_t bit(Bit(leaf->hash, shift));
+    const std::size_t position(Position(writable->bitmap, bit));
+    if ((writable->bitmap & bit) == 0) {
+      writable->bitmap |= bit;
+      Slot slot{ nullptr, std::move(leaf) };
+      writable->slots.insert(writable->slots.begin() + position, std::move(slot));
+      return;
+    }
+    Slot& slot(writable->slots[position]);
+    if (slot.child) {
+      Insert(slot.child, shift + kBits, std::move(leaf));
+    } else if (slot.leaf->hash == leaf->hash) {
+      slot.leaf = std::make_shared<const Leaf>(leaf->hash, leaf->key, leaf->value, slot.leaf);
+    } else {
+      // Push the existing chain down a level and add the new leaf beside it.
+      Insert(slot.child, shift + kBits, std::move(slot.leaf));
+      Insert(slot.child, shift + kBits, std::move(leaf));
+      slot.leaf.reset();
+    }
+  }
+
+  // 'key' must be held beneath 'node'.  Resets 'node' if it would be left empty.
+  static void Erase(std::shared_ptr<const Node>& node, unsigned shift, std::size_t hash,
+                    const std::string& key) {
+    Node* const writable(Writable(node));
+    const std::uint32_t bit(Bit(hash, shift));
+    const std::size_t position(Position(writable->bitmap, bit));
+    Slot& slot(writable->slots[position]);
+    if (slot.child)
+      Erase(slot.child, shift + kBits, hash, key);
+    else
+      slot.leaf = WithoutKey(slot.leaf.get(), key);
+    if (!slot.child && !slot.leaf) {
+      writable->bitmap &= ~bit;
+      writable->slots.erase(writable->slots.begin() + position);
+    }
+    if (writable->slots.empty())
+      node.reset();
+  }
+
+  // As for PersistentVector.
+  static Node* Writable(std::shared_ptr<const Node>& node) {
+    if (!node)
+      node = std::make_shared<Node>();
+    else if (node.use_count() != 1)
+      node = std::make_shared<Node>(*node);
+    else
+      std::atomic_thread_fence(std::memory_order_acquire);
+    return const_cast<Node*>(node.get());
+  }
+
+  static std::shared_ptr<const Leaf> WithoutKey(const Leaf* leaf, const std::string& key) {
+    if (leaf->key == key)
+      return leaf->next;
+    return std::make_shared<const Leaf>(leaf->hash, leaf->key, leaf->value,
+                                        WithoutKey(leaf->next.get(), key));
+  }
+
+  std::shared_ptr<const Node> root_;
+  std::size_t size_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_PERSISTENT_CONTAINERS_H_
@@ -19,14 +19,23 @@
 #ifndef MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_H_
 #define MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_H_
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "maidsafe/common/rsa.h"
 #include "maidsafe/common/types.h"
 
+#include "maidsafe/passport/detail/byte_view.h"
+#include "maidsafe/passport/detail/compact_format.h"
 #include "maidsafe/passport/detail/config.h"
 #include "maidsafe/passport/detail/fob.h"
+#include "maidsafe/passport/detail/parallel.h"
+#include "maidsafe/passport/detail/serialisation_buffer.h"
+#include "maidsafe/passport/detail/verification_cache.h"
 
 #include "maidsafe/common/serialisation/serialisation.h"
 
@@ -36,6 +45,9 @@ namespace passport {
 
 namespace detail {
 
+// The public key is held in its encoded form and only decoded the first time it's needed, so
+// parsing a public fob which is merely stored or forwarded costs no key decoding.  The decoded key
+// is then shared by all copies made afterwards.  Decoding is thread-safe.
 template <typename TagType>
 class PublicFob {
  public:
@@ -48,18 +60,21 @@ class PublicFob {
 
   PublicFob(const PublicFob& other)
       : name_(other.name_),
-        public_key_(other.public_key_),
+        public_key_(std::atomic_load(&other.public_key_)),
+        encoded_public_key_(other.encoded_public_key_),
         validation_token_(other.validation_token_) {}
 
   PublicFob(PublicFob&& other)
       : name_(std::move(other.name_)),
         public_key_(std::move(other.public_key_)),
+        encoded_public_key_(std::move(other.encoded_public_key_)),
         validation_token_(std::move(other.validation_token_)) {}
 
   friend void swap(PublicFob& lhs, PublicFob& rhs) {
     using std::swap;
     swap(lhs.name_, rhs.name_);
     swap(lhs.public_key_, rhs.public_key_);
+    swap(lhs.encoded_public_key_, rhs.encoded_public_key_);
     swap(lhs.validation_token_, rhs.validation_token_);
   }
 
@@ -69,26 +84,78 @@ class PublicFob {
   }
 
   explicit PublicFob(const Fob<Tag>& fob)
-      : name_(fob.name()),
-        public_key_(fob.public_key()),
-        validation_token_(fob.validation_token()) {}
+      : name_(fob.name_ref()),
+        public_key_(std::make_shared<const asymm::PublicKey>(fob.public_key_ref())),
+        encoded_public_key_(fob.encoded_public_key()),
+        validation_token_(fob.validation_token_ref()) {}
 
   PublicFob(Name name, const serialised_type& serialised_public_fob)
-      : name_(std::move(name)), public_key_(), validation_token_() {
-    if (!name_->IsInitialised())
+      : PublicFob(std::move(name), View(serialised_public_fob)) {}
+
+  // Parses in place from bytes held elsewhere, e.g. in a receive buffer.  Accepts either format.
+  PublicFob(Name name, ByteView serialised_public_fob)
+      : name_(std::move(name)), public_key_(), encoded_public_key_(), validation_token_() {
+    if (!name_->IsInitialised() || serialised_public_fob.empty())
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
 
-    try { maidsafe::ConvertFromString(serialised_public_fob.data.string(), *this); }
+    try {
+      if (IsCompactFormat(serialised_public_fob)) {
+        ParseCompactPublicFob(Tag::kValue, serialised_public_fob, encoded_public_key_,
+                              validation_token_);
+      } else {
+        ParseFromView(serialised_public_fob, *this);
+      }
+    }
     catch(...) { BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error)); }
   }
 
-  serialised_type Serialise() const {
-    return serialised_type(NonEmptyString {maidsafe::ConvertToString(*this)});
+  serialised_type Serialise(WireFormat format = WireFormat::kV1) const {
+    if (format == WireFormat::kV1)
+      return serialised_type(NonEmptyString {maidsafe::ConvertToString(*this)});
+    return serialised_type(NonEmptyString {
+        SerialiseCompactPublicFob(Tag::kValue, encoded_public_key_, validation_token_)});
   }
+  // Appends the bytes held by Serialise()'s result.
+  void SerialiseInto(SerialisationBuffer& buffer) const { buffer.Write(*this); }
 
   Name name() const { return name_; }
-  asymm::PublicKey public_key() const { return public_key_; }
+  // Throws parsing_error if the encoded public key is invalid.
+  asymm::PublicKey public_key() const { return public_key_ref(); }
   asymm::Signature validation_token() const { return validation_token_; }
+  // Non-copying equivalents of the above, valid for the lifetime of this public fob.
+  const Name& name_ref() const { return name_; }
+  const asymm::PublicKey& public_key_ref() const {
+    std::shared_ptr<const asymm::PublicKey> public_key(std::atomic_load(&public_key_));
+    if (!public_key) {
+      std::shared_ptr<const asymm::PublicKey> decoded;
+      try {
+        decoded = std::make_shared<const asymm::PublicKey>(asymm::DecodeKey(encoded_public_key_));
+      }
+      catch (...) {
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      }
+      // If another thread got there first, its key is kept and returned.
+      if (std::atomic_compare_exchange_strong(&public_key_, &public_key, decoded))
+        public_key = decoded;
+    }
+    return *public_key;
+  }
+  const asymm::Signature& validation_token_ref() const { return validation_token_; }
+  const asymm::EncodedPublicKey& encoded_public_key() const { return encoded_public_key_; }
+  bool public_key_decoded() const { return std::atomic_load(&public_key_) != nullptr; }
+
+  // Returns whether this public fob's validation token is 'signer''s signature of its public key.
+  // Results are held in VerificationCache::Instance(), so repeating a check needs no RSA operation.
+  // Throws parsing_error if the signer's public key has to be decoded and is invalid.
+  bool ValidateAgainst(const PublicFob<typename SignerFob<Tag>::Tag>& signer) const {
+    return VerificationCache::Instance().Verify(
+        { name_->string(), encoded_public_key_.string(), validation_token_.string(),
+          signer.name_ref()->string(), signer.encoded_public_key().string() },
+        [&] {
+          return asymm::CheckSignature(asymm::PlainText{ encoded_public_key_ }, validation_token_,
+                                       signer.public_key_ref());
+        });
+  }
 
   template<typename Archive>
   Archive& load(Archive& ref_archive) {
@@ -100,23 +167,77 @@ class PublicFob {
       BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
     }
 
-    public_key_ = asymm::DecodeKey(asymm::EncodedPublicKey {std::move(temp_raw_public_key)});
+    encoded_public_key_ = asymm::EncodedPublicKey {std::move(temp_raw_public_key)};
+    public_key_.reset();
     return archive;
   }
 
   template<typename Archive>
   Archive& save(Archive& ref_archive) const {
     return ref_archive(static_cast<std::uint32_t>(Tag::kValue),
-                       asymm::EncodeKey(public_key_).string(),
+                       encoded_public_key_.string(),
                        validation_token_);
   }
 
  private:
+  static ByteView View(const serialised_type& serialised_public_fob) {
+    if (!serialised_public_fob.data.IsInitialised())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return ByteView(serialised_public_fob.data.string());
+  }
+
   Name name_;
-  asymm::PublicKey public_key_;
+  mutable std::shared_ptr<const asymm::PublicKey> public_key_;
+  asymm::EncodedPublicKey encoded_public_key_;
   asymm::Signature validation_token_;
 };
 
+// Returns whether 'public_fob' and 'signer' form a valid chain: both names are derived from their
+// keys and validation tokens (except the user-chosen name of a PublicMpid), 'signer' is
+// self-signed and 'public_fob' is signed by 'signer'.  Never throws; an undecodable key fails.
+template <typename TagType>
+bool ValidateSignerChain(const PublicFob<TagType>& public_fob,
+                         const PublicFob<typename SignerFob<TagType>::Tag>& signer) {
+  try {
+    if (!std::is_same<TagType, MpidTag>::value &&
+        CreateFobName(public_fob.encoded_public_key(), public_fob.validation_token_ref()) !=
+            public_fob.name_ref().value) {
+      return false;
+    }
+    if (CreateFobName(signer.encoded_public_key(), signer.validation_token_ref()) !=
+        signer.name_ref().value) {
+      return false;
+    }
+    return signer.ValidateAgainst(signer) && public_fob.ValidateAgainst(signer);
+  }
+  catch (const std::exception&) {
+    return false;
+  }
+}
+
+// Validates 'count' chains starting at 'chains' (see ValidateSignerChain), spread across
+// 'thread_count' threads, where zero means one per hardware core.  Element i of the result is true
+// if chain i is valid.
+template <typename TagType>
+std::vector<bool> ValidateSignerChains(
+    const std::pair<PublicFob<TagType>, PublicFob<typename SignerFob<TagType>::Tag>>* chains,
+    std::size_t count, unsigned thread_count = 0) {
+  // Threads mustn't write neighbouring bits of a vector<bool>, so collect results as bytes first.
+  std::vector<std::uint8_t> results(count, 0);
+  ParallelFor(count, thread_count, [&](std::size_t index) {
+    results[index] = ValidateSignerChain(chains[index].first, chains[index].second) ? 1 : 0;
+  });
+  return std::vector<bool>(std::begin(results), std::end(results));
+}
+
+template <typename TagType>
+std::vector<bool> ValidateSignerChains(
+    const std::vector<std::pair<PublicFob<TagType>, PublicFob<typename SignerFob<TagType>::Tag>>>&
+        chains,
+    unsigned thread_count = 0) {
+  return ValidateSignerChains(chains.data(), chains.size(), thread_count);
+}
+
 }  // namespace detail
 
 }  // namespace passport
@@ -0,0 +1,200 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_CODEC_H_
+#define MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_CODEC_H_
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/types.h"
+
+#include "maidsafe/passport/detail/byte_view.h"
+#include "maidsafe/passport/detail/compact_format.h"
+#include "maidsafe/passport/detail/config.h"
+#include "maidsafe/passport/detail/fob.h"
+#include "maidsafe/passport/detail/parallel.h"
+#include "maidsafe/passport/detail/public_fob.h"
+#include "maidsafe/passport/detail/public_fob_view.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// Bulk encoding of public fobs of one type as a single blob, with integers as 4-byte little-endian:
+//   version | tag | count | offsets (count + 1) | elements
+// Offsets are from the start of the blob, and element i spans [offsets[i], offsets[i + 1]).  Each
+// element is the public fob in the compact layout, preceded for a PublicMpid by its name; other
+// names are recomputed from the key and validation token.  So any element can be viewed, decoded
+// or forwarded on its own, without touching the rest.
+const std::size_t kPublicFobsHeaderSize(6);
+
+inline void PutUint32(std::size_t value, char* bytes) {
+  for (int i(0); i != 4; ++i)
+    bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+}
+
+inline std::size_t GetUint32(ByteView bytes, std::size_t offset) {
+  std::size_t value(0);
+  for (int i(0); i != 4; ++i)
+    value |= static_cast<std::size_t>(static_cast<std::uint8_t>(bytes[offset + i])) << (8 * i);
+  return value;
+}
+
+// Throws serialisation_error if the blob would exceed 4 GiB.
+template <typename Tag>
+std::string EncodePublicFobs(const std::vector<PublicFob<Tag>>& public_fobs) {
+  const std::size_t name_size(Tag::kValue == MpidTag::kValue ? kCompactMpidNameSize : 0);
+  const std::size_t table_end(kPublicFobsHeaderSize + (public_fobs.size() + 1) * 4);
+  std::size_t size(table_end);
+  for (const auto& public_fob : public_fobs) {
+    size += name_size + kCompactPublicFobHeaderSize +
+            public_fob.encoded_public_key().string().size() +
+            public_fob.validation_token_ref().string().size();
+  }
+  if (size > std::numeric_limits<std::uint32_t>::max())
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+
+  std::string encoded;
+  encoded.reserve(size);
+  encoded.push_back(static_cast<char>(kCompactFormatVersion));
+  encoded.push_back(static_cast<char>(Tag::kValue));
+  encoded.resize(table_end);
+  PutUint32(public_fobs.size(), &encoded[2]);
+  for (std::size_t i(0); i != public_fobs.size(); ++i) {
+    PutUint32(encoded.size(), &encoded[kPublicFobsHeaderSize + 4 * i]);
+    if (name_size != 0) {
+      const std::string& name(public_fobs[i].name_ref()->string());
+      if (name.size() != name_size)
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+      encoded += name;
+    }
+    AppendCompactPublicFob(Tag::kValue, public_fobs[i].encoded_public_key(),
+                           public_fobs[i].validation_token_ref(), encoded);
+  }
+  PutUint32(encoded.size(), &encoded[table_end - 4]);
+  return encoded;
+}
+
+// Random access to the public fobs in a blob made by EncodePublicFobs, which must outlive it.
+// Construction checks the header and offset table; elements are only read when accessed.
+template <typename TagType>
+class PublicFobsView {
+ public:
+  typedef TagType Tag;
+  typedef PublicFob<Tag> PublicFobType;
+
+  // Throws parsing_error if the header or offset table is malformed.
+  explicit PublicFobsView(ByteView encoded) : encoded_(encoded), count_(0) {
+    if (encoded.size() < kPublicFobsHeaderSize + 4 ||
+        static_cast<std::uint8_t>(encoded[0]) != kCompactFormatVersion ||
+        DataTagValue(static_cast<std::uint8_t>(encoded[1])) != Tag::kValue) {
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+    const std::size_t count(GetUint32(encoded, 2));
+    if (count >= (encoded.size() - kPublicFobsHeaderSize) / 4)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    const std::size_t table_end(kPublicFobsHeaderSize + (count + 1) * 4);
+    std::size_t offset(table_end);
+    for (std::size_t i(0); i <= count; ++i) {
+      const std::size_t next_offset(GetUint32(encoded, kPublicFobsHeaderSize + 4 * i));
+      if (i == 0 ? next_offset != table_end : next_offset < offset)
+        BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+      offset = next_offset;
+    }
+    if (offset != encoded.size())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    count_ = count;
+  }
+
+  std::size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+
+  // These throw no_such_element if 'index' is out of range, and parsing_error if the element is
+  // malformed.  View reads the element in place; Decode parses it into a full public fob.
+  PublicFobView<Tag> View(std::size_t index) const {
+    return PublicFobView<Tag>(Element(index).substr(NameSize()));
+  }
+
+  PublicFobType Decode(std::size_t index) const {
+    const ByteView element(Element(index));
+    const PublicFobView<Tag> view(element.substr(NameSize()));
+    Identity name;
+    if (NameSize() != 0) {
+      name = Identity(element.substr(0, NameSize()).to_string());
+    } else {
+      name = CreateFobName(asymm::EncodedPublicKey(view.encoded_public_key().to_string()),
+                           asymm::Signature(view.validation_token().to_string()));
+    }
+    return PublicFobType(typename PublicFobType::Name(std::move(name)), view.serialised());
+  }
+
+ private:
+  static std::size_t NameSize() {
+    return Tag::kValue == MpidTag::kValue ? kCompactMpidNameSize : 0;
+  }
+
+  ByteView Element(std::size_t index) const {
+    if (index >= count_)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+    const std::size_t begin(GetUint32(encoded_, kPublicFobsHeaderSize + 4 * index));
+    const std::size_t end(GetUint32(encoded_, kPublicFobsHeaderSize + 4 * (index + 1)));
+    if (end - begin < NameSize())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return encoded_.substr(begin, end - begin);
+  }
+
+  ByteView encoded_;
+  std::size_t count_;
+};
+
+// Decodes every public fob in a blob made by EncodePublicFobs, spread across 'thread_count'
+// threads, where zero means one per hardware core.  Throws parsing_error if any is malformed.
+template <typename Tag>
+std::vector<PublicFob<Tag>> DecodePublicFobs(ByteView encoded, unsigned thread_count = 0) {
+  const PublicFobsView<Tag> view(encoded);
+  std::vector<std::unique_ptr<PublicFob<Tag>>> decoded(view.size());
+  ParallelFor(view.size(), thread_count, [&](std::size_t index) {
+    decoded[index] = maidsafe::make_unique<PublicFob<Tag>>(view.Decode(index));
+  });
+
+  std::vector<PublicFob<Tag>> public_fobs;
+  public_fobs.reserve(decoded.size());
+  for (auto& public_fob : decoded)
+    public_fobs.push_back(std::move(*public_fob));
+  return public_fobs;
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_CODEC_H_
@@ -0,0 +1,89 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_VIEW_H_
+#define MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_VIEW_H_
+
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/data_types/data_type_values.h"
+
+#include "maidsafe/passport/detail/byte_view.h"
+#include "maidsafe/passport/detail/compact_format.h"
+#include "maidsafe/passport/detail/public_fob.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// A non-owning view of a public fob in the compact (v2) layout, for code which receives, stores or
+// forwards public fobs far more often than it uses their keys.  Construction only checks the
+// fixed-size header against the buffer; the fields are then read in place at the offsets it gives,
+// and the bytes can be stored or forwarded as they are.  The bytes must outlive the view.
+// ToPublicFob() does the full parse for when the keys are needed.
+template <typename TagType>
+class PublicFobView {
+ public:
+  typedef TagType Tag;
+  typedef PublicFob<Tag> PublicFobType;
+
+  // Throws parsing_error unless 'serialised' is a well-formed compact public fob of this type.
+  explicit PublicFobView(ByteView serialised)
+      : serialised_(serialised), fields_(ReadCompactPublicFobFields(serialised)) {
+    if (fields_.tag != Tag::kValue)
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  // As above, viewing the data held by 'serialised', which must outlive the view.
+  explicit PublicFobView(const typename PublicFobType::serialised_type& serialised)
+      : PublicFobView(Bytes(serialised)) {}
+
+  DataTagValue tag() const { return fields_.tag; }
+  ByteView encoded_public_key() const { return fields_.public_key; }
+  ByteView validation_token() const { return fields_.validation_token; }
+  // The whole serialised public fob.
+  ByteView serialised() const { return serialised_; }
+
+  // Parses the viewed bytes into a full public fob called 'name'.  Throws as the equivalent
+  // PublicFob constructor does.
+  PublicFobType ToPublicFob(typename PublicFobType::Name name) const {
+    return PublicFobType(std::move(name), serialised_);
+  }
+
+ private:
+  static ByteView Bytes(const typename PublicFobType::serialised_type& serialised) {
+    if (!serialised.data.IsInitialised())
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    return ByteView(serialised.data.string());
+  }
+
+  ByteView serialised_;
+  CompactPublicFobFields fields_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_PUBLIC_FOB_VIEW_H_
@@ -0,0 +1,119 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_SERIALISATION_BUFFER_H_
+#define MAIDSAFE_PASSPORT_DETAIL_SERIALISATION_BUFFER_H_
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <utility>
+
+#include "cereal/archives/binary.hpp"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// A reusable output buffer written through the same binary archive as maidsafe::ConvertToString,
+// so writing a value appends exactly the bytes ConvertToString would return for it.  Clearing keeps
+// the capacity, so once a buffer has grown to fit, serialising into it again allocates nothing.
+//
+// Nested serialised objects (fields holding another object's serialised form as a string) can be
+// written in place with WriteString, avoiding the intermediate string and the second copy.
+class SerialisationBuffer {
+ public:
+  SerialisationBuffer()
+      : buffer_(), stream_buffer_(buffer_), stream_(&stream_buffer_), archive_(stream_) {}
+
+  template <typename T>
+  void Write(const T& value) {
+    archive_(value);
+  }
+
+  // Writes a string field whose contents are appended by 'write_contents(*this)'.  The result is
+  // identical to Write()ing a string holding those contents.
+  template <typename WriteContents>
+  void WriteString(const WriteContents& write_contents) {
+    const std::size_t prefix_position(buffer_.size());
+    archive_(static_cast<cereal::size_type>(0));
+    write_contents(*this);
+    const cereal::size_type size(buffer_.size() - prefix_position - sizeof(cereal::size_type));
+    std::memcpy(&buffer_[prefix_position], &size, sizeof(size));
+  }
+
+  // Appends raw bytes, e.g. an object already in serialised form, within WriteString.
+  void WriteBytes(const std::string& bytes) { buffer_.append(bytes); }
+
+  const std::string& string() const { return buffer_; }
+  std::size_t size() const { return buffer_.size(); }
+  void Reserve(std::size_t capacity) { buffer_.reserve(capacity); }
+  void Clear() { buffer_.clear(); }
+  // As Clear(), but first overwrites the contents with zeros, for buffers which held secrets.
+  void Wipe() {
+    std::fill(std::begin(buffer_), std::end(buffer_), '\0');
+    buffer_.clear();
+  }
+  // Moves the contents out, leaving the buffer empty without any capacity.
+  std::string Release() {
+    std::string released;
+    released.swap(buffer_);
+    return released;
+  }
+
+ private:
+  class AppendBuffer : public std::streambuf {
+   public:
+    explicit AppendBuffer(std::string& buffer) : buffer_(buffer) {}
+
+   protected:
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+      buffer_.append(data, static_cast<std::size_t>(size));
+      return size;
+    }
+    int_type overflow(int_type character) override {
+      if (!traits_type::eq_int_type(character, traits_type::eof()))
+        buffer_.push_back(traits_type::to_char_type(character));
+      return traits_type::not_eof(character);
+    }
+
+   private:
+    std::string& buffer_;
+  };
+
+  SerialisationBuffer(const SerialisationBuffer&) = delete;
+  SerialisationBuffer(SerialisationBuffer&&) = delete;
+  SerialisationBuffer& operator=(SerialisationBuffer) = delete;
+
+  std::string buffer_;
+  AppendBuffer stream_buffer_;
+  std::ostream stream_;
+  cereal::BinaryOutputArchive archive_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_SERIALISATION_BUFFER_H_
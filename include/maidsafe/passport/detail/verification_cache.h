@@ -0,0 +1,84 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_VERIFICATION_CACHE_H_
+#define MAIDSAFE_PASSPORT_DETAIL_VERIFICATION_CACHE_H_
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// A bounded, thread-safe cache of signature verification results.  Each result is keyed by the
+// SHA-512 digest of every input to the verification (length-prefixed, so that no two distinct sets
+// of inputs share a key), which makes repeating a verification cost a hash and a lookup.  Least
+// recently used results are evicted to stay within the capacity.
+class VerificationCache {
+ public:
+  struct Statistics {
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::size_t entry_count;
+    // Fraction of lookups answered from the cache, or zero if there have been none.
+    double hit_ratio;
+  };
+
+  // The process-wide cache used by PublicFob::ValidateAgainst.
+  static VerificationCache& Instance();
+
+  explicit VerificationCache(std::size_t capacity);
+
+  // Returns the cached result for 'inputs' if held, otherwise the result of 'verify', which is
+  // cached unless it throws.  'verify' is called without the cache locked.
+  bool Verify(std::initializer_list<std::reference_wrapper<const std::string>> inputs,
+              const std::function<bool()>& verify);
+
+  Statistics GetStatistics() const;
+  void Clear();
+
+ private:
+  typedef std::list<std::pair<std::string, bool>> Entries;
+
+  VerificationCache(const VerificationCache&) = delete;
+  VerificationCache(VerificationCache&&) = delete;
+  VerificationCache& operator=(VerificationCache) = delete;
+
+  const std::size_t capacity_;
+  Entries entries_;
+  std::unordered_map<std::string, Entries::iterator> index_;
+  std::uint64_t hits_, misses_;
+  mutable std::mutex mutex_;
+};
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_VERIFICATION_CACHE_H_
@@ -0,0 +1,57 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#ifndef MAIDSAFE_PASSPORT_DETAIL_WIPE_H_
+#define MAIDSAFE_PASSPORT_DETAIL_WIPE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "maidsafe/common/types.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+// Overwrites the contents of 'secret' with zeros.  Writing through a volatile pointer stops the
+// compiler eliding a wipe of memory which is about to be freed.
+inline void Wipe(const std::string& secret) {
+  volatile char* target(const_cast<char*>(secret.data()));
+  for (std::size_t size(secret.size()); size != 0; --size)
+    *target++ = 0;
+}
+
+// Takes ownership of 'contents', which is wiped when the last reference is released.
+inline std::shared_ptr<const NonEmptyString> MakeWipedOnRelease(std::string contents) {
+  return std::shared_ptr<const NonEmptyString>(
+      new NonEmptyString{ std::move(contents) }, [](const NonEmptyString* secret) {
+        Wipe(secret->string());
+        delete secret;
+      });
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
+
+#endif  // MAIDSAFE_PASSPORT_DETAIL_WIPE_H_
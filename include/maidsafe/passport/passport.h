@@ -19,18 +19,24 @@
 #ifndef MAIDSAFE_PASSPORT_PASSPORT_H_
 #define MAIDSAFE_PASSPORT_PASSPORT_H_
 
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "boost/range/iterator_range.hpp"
+
 #include "maidsafe/common/crypto.h"
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/types.h"
 
+#include "maidsafe/passport/credential_session.h"
 #include "maidsafe/passport/types.h"
+#include "maidsafe/passport/detail/fob_cache.h"
+#include "maidsafe/passport/detail/keys_and_signers.h"
 
 namespace maidsafe {
 
@@ -69,6 +75,16 @@ Anpmid DecryptAnpmid(const crypto::CipherText& encrypted_anpmid, const crypto::A
 Pmid DecryptPmid(const crypto::CipherText& encrypted_pmid, const crypto::AES256Key& symm_key,
                  const crypto::AES256InitialisationVector& symm_iv);
 
+// Enables caches of validated fobs, keyed by the digest of their serialised form and the validation
+// mode, which every passport constructed from its encrypted form then parses through.  Reloading a
+// passport, or one sharing entries with a passport already loaded, copies the cached fobs rather
+// than decoding and validating their keys again.  Entries held by LoadMode::kLazy passports don't
+// use the caches.  'memory_limit' bounds the cache for each fob
+// type, as per detail::FobCache.  Zero, the default, disables and frees the caches.
+void ConfigureParseCache(std::size_t memory_limit);
+// Totals across the caches of every fob type.  All zero while disabled.
+detail::FobCacheStatistics GetParseCacheStatistics();
+
 typedef std::pair<Maid, Maid::Signer> MaidAndSigner;
 typedef std::pair<Pmid, Pmid::Signer> PmidAndSigner;
 typedef std::pair<Mpid, Mpid::Signer> MpidAndSigner;
@@ -77,19 +93,118 @@ MaidAndSigner CreateMaidAndSigner();
 PmidAndSigner CreatePmidAndSigner();
 MpidAndSigner CreateMpidAndSigner(const NonEmptyString& chosen_name);
 
+// Batch variants of the above.  Key generation and signing are spread across 'thread_count'
+// threads (one per hardware core if zero) and the results are returned in order; for Mpids, the
+// i-th result has the i-th chosen name.  If any creation throws, the exception for the lowest
+// index is rethrown.
+std::vector<MaidAndSigner> CreateMaidAndSignerBatch(std::size_t count, unsigned thread_count = 0);
+std::vector<PmidAndSigner> CreatePmidAndSignerBatch(std::size_t count, unsigned thread_count = 0);
+std::vector<MpidAndSigner> CreateMpidAndSignerBatch(
+    const std::vector<NonEmptyString>& chosen_names, unsigned thread_count = 0);
+
+// How 'Passport::Encrypt' protects the serialised passport.  kDirect encrypts it under keys derived
+// from the user credentials.  kEnvelope encrypts it under a random data key, and stores that key
+// encrypted under the credential-derived keys, so that 'RewrapPassport' can move the passport to
+// new credentials without re-encrypting the body.  Decryption detects the format automatically.
+enum class EncryptionFormat { kDirect, kEnvelope };
+
+// How a passport constructed from its encrypted form treats its Pmids and Mpids.  kEager decodes
+// and validates them all during construction.  kLazy reads only their names, and decodes and
+// validates each on first access, so construction cost doesn't grow with their number; an invalid
+// entry is then reported when it's accessed rather than by the constructor.  Entries which are
+// never accessed are re-serialised from their original bytes.  The Maid is always decoded eagerly.
+enum class LoadMode { kEager, kLazy };
+
+// How a passport constructed from its encrypted form checks its signers' private keys.  kValidate
+// checks them as it does the keys they sign.  kDefer leaves them encoded until first used, as per
+// ValidationMode::kDeferred; signers are only used to sign revocations, so this saves a decode per
+// entry, but a corrupt signer key is then only reported by the revocation which needs it.
+enum class SignerValidation { kValidate, kDefer };
+
+// Re-encrypts the data key of an envelope-format encrypted passport for 'new_session', leaving the
+// body untouched.  Throws if 'encrypted_passport' isn't in envelope format or if 'old_session'
+// can't decrypt its data key.
+crypto::CipherText RewrapPassport(const crypto::CipherText& encrypted_passport,
+                                  const CredentialSession& old_session,
+                                  const CredentialSession& new_session);
+
 // The Passport class contains identity types for the various network related tasks available, see
 // types.h for details about the identity types.
 class Passport {
  public:
+  // An immutable view of the passport's contents at one point in time.  Obtaining and reading a
+  // snapshot takes no passport lock and copies no keys; changes made to the passport afterwards are
+  // not reflected in it.  Cheap to copy, and safe to share between threads.
+  class Snapshot {
+   public:
+    typedef boost::iterator_range<detail::KeysAndSigners<Pmid>::const_key_iterator> PmidRange;
+    typedef boost::iterator_range<detail::KeysAndSigners<Mpid>::const_key_iterator> MpidRange;
+
+    // Throws if the snapshot doesn't contain a Maid.
+    const Maid& GetMaid() const;
+
+    // Returns all the keys of the given type in the order they were added (may be empty).  The
+    // range holds its own reference to the keys, so remains valid after this Snapshot is destroyed.
+    // If the passport was loaded with LoadMode::kLazy, dereferencing an element decodes it, and
+    // throws parsing_error if it's invalid.
+    PmidRange GetPmids() const;
+    MpidRange GetMpids() const;
+
+    // Returns nullptr if the snapshot doesn't contain a key called 'name'.  The key is only valid
+    // while this Snapshot, or a copy of it, exists.  If the passport was loaded with
+    // LoadMode::kLazy, the key is decoded on first access, and parsing_error is thrown (on that and
+    // every later access) if it's invalid.
+    const Pmid* FindPmid(const Pmid::Name& name) const;
+    const Mpid* FindMpid(const Mpid::Name& name) const;
+
+   private:
+    friend class Passport;
+    Snapshot();
+
+    // Incremented each time a new version is published.
+    std::uint64_t generation_;
+    std::shared_ptr<const MaidAndSigner> maid_and_signer_;
+    std::shared_ptr<const detail::KeysAndSigners<Pmid>> pmids_and_signers_;
+    std::shared_ptr<const detail::KeysAndSigners<Mpid>> mpids_and_signers_;
+  };
+
+  // The serialised form of the passport is cached and reused by 'Encrypt' until the passport is
+  // next modified.  These count how often it was reused or had to be rebuilt.
+  struct SerialisationStatistics {
+    std::uint64_t cache_hits;
+    std::uint64_t rebuilds;
+  };
+
   explicit Passport(MaidAndSigner maid_and_signer);
 
   // Constructs from a previously-encrypted passport.  All fields of 'user_credentials' must be
   // identical to those used during the encryption.  Throws if unable to decrypt and parse.
+  // 'key_validation' is how keys are checked when they're decoded, and 'signer_validation' whether
+  // signers are checked likewise.  Fobs served by the parse cache were validated in the same mode
+  // when first parsed.
   Passport(const crypto::CipherText& encrypted_passport,
-           const authentication::UserCredentials& user_credentials);
+           const authentication::UserCredentials& user_credentials,
+           LoadMode load_mode = LoadMode::kEager,
+           detail::ValidationMode key_validation = detail::ValidationMode::kKeyConsistency,
+           SignerValidation signer_validation = SignerValidation::kValidate);
   // Serialises and encrypts the entire contents of the passport.  Throws if any of the user
   // credential fields are null, or if the passport doesn't contain a Maid.
-  crypto::CipherText Encrypt(const authentication::UserCredentials& user_credentials) const;
+  crypto::CipherText Encrypt(const authentication::UserCredentials& user_credentials,
+                             EncryptionFormat format = EncryptionFormat::kDirect) const;
+
+  // As above, but using keys already derived by 'session', which avoids repeating the costly key
+  // derivation when a passport is encrypted or decrypted more than once with the same credentials.
+  Passport(const crypto::CipherText& encrypted_passport, const CredentialSession& session,
+           LoadMode load_mode = LoadMode::kEager,
+           detail::ValidationMode key_validation = detail::ValidationMode::kKeyConsistency,
+           SignerValidation signer_validation = SignerValidation::kValidate);
+  crypto::CipherText Encrypt(const CredentialSession& session,
+                             EncryptionFormat format = EncryptionFormat::kDirect) const;
+
+  // Returns the current contents.  Doesn't throw.
+  Snapshot GetSnapshot() const;
+
+  SerialisationStatistics GetSerialisationStatistics() const;
 
   // Throws if the passport doesn't contain a Maid.
   Maid GetMaid() const;
@@ -98,7 +213,8 @@ class Passport {
   void AddKeyAndSigner(PmidAndSigner pmid_and_signer);
   void AddKeyAndSigner(MpidAndSigner mpid_and_signer);
 
-  // Returns all the keys of the given type (may be empty).  Doesn't throw.
+  // Returns all the keys of the given type (may be empty).  Doesn't throw unless the passport was
+  // loaded lazily and an entry fails to decode.
   std::vector<Pmid> GetPmids() const;
   std::vector<Mpid> GetMpids() const;
 
@@ -121,16 +237,34 @@ class Passport {
   Passport(Passport&&) = delete;
   Passport& operator=(Passport) = delete;
 
-  void Parse(const NonEmptyString& serialised_passport);
-  NonEmptyString Serialise() const;
+  void Parse(const NonEmptyString& serialised_passport, LoadMode load_mode,
+             detail::ValidationMode key_validation, detail::ValidationMode signer_validation);
+  // Returns the cached serialised form if the passport hasn't changed since it was built.
+  std::shared_ptr<const NonEmptyString> Serialise() const;
+  // 'size_hint' is the expected size, reserved up front if the calling thread's buffer is smaller.
+  // The result holds every private key, so is wiped when its last reference is released.
+  static std::shared_ptr<const NonEmptyString> SerialiseSnapshot(const Snapshot& snapshot,
+                                                                 std::size_t size_hint);
 
   void Decrypt(const crypto::CipherText& encrypted_passport,
                const authentication::UserCredentials& user_credentials);
 
-  std::unique_ptr<MaidAndSigner> maid_and_signer_;
-  std::vector<PmidAndSigner> pmids_and_signers_;
-  std::vector<MpidAndSigner> mpids_and_signers_;
-  mutable std::mutex mutex_;
+  // Publishes a copy of the current snapshot modified by 'update', retrying if another collection's
+  // writer publishes first.  'update' must be cheap, as it may be called more than once.
+  template <typename Update>
+  void Publish(const Update& update);
+
+  // Only ever accessed through the std::atomic_* shared_ptr functions.  Writers build the new
+  // version of their collection while holding that collection's mutex, then publish it.
+  std::shared_ptr<const Snapshot> snapshot_;
+  std::mutex maid_mutex_, pmids_mutex_, mpids_mutex_;
+
+  // Built by SerialiseSnapshot, so wiped once replaced and released by every Encrypt using it, or
+  // when the passport is destroyed.
+  mutable std::shared_ptr<const NonEmptyString> serialised_;
+  mutable std::uint64_t serialised_generation_;
+  mutable SerialisationStatistics serialisation_statistics_;
+  mutable std::mutex serialised_mutex_;
 };
 
 template <>
@@ -25,6 +25,7 @@
 #include "maidsafe/passport/detail/config.h"
 #include "maidsafe/passport/detail/fob.h"
 #include "maidsafe/passport/detail/public_fob.h"
+#include "maidsafe/passport/detail/public_fob_view.h"
 
 namespace maidsafe {
 
@@ -72,6 +73,16 @@ typedef detail::PublicFob<detail::PmidTag> PublicPmid;
 typedef detail::PublicFob<detail::AnmpidTag> PublicAnmpid;
 typedef detail::PublicFob<detail::MpidTag> PublicMpid;
 
+// Views of the above in their compact serialised form, for storing and forwarding without parsing.
+typedef detail::PublicFobView<detail::AnmaidTag> PublicAnmaidView;
+typedef detail::PublicFobView<detail::MaidTag> PublicMaidView;
+
+typedef detail::PublicFobView<detail::AnpmidTag> PublicAnpmidView;
+typedef detail::PublicFobView<detail::PmidTag> PublicPmidView;
+
+typedef detail::PublicFobView<detail::AnmpidTag> PublicAnmpidView;
+typedef detail::PublicFobView<detail::MpidTag> PublicMpidView;
+
 // Public key type traits.
 template <typename T>
 struct is_public_key_type : public std::false_type {};
@@ -0,0 +1,209 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/compact_format.h"
+
+#include "maidsafe/common/error.h"
+
+#include "maidsafe/passport/detail/fob.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+namespace {
+
+const std::size_t kMaxFieldSize(0xFFFF);
+
+void AppendHeader(DataTagValue tag, std::string& serialised) {
+  if (static_cast<std::uint32_t>(tag) > 0xFF)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  serialised.push_back(static_cast<char>(kCompactFormatVersion));
+  serialised.push_back(static_cast<char>(tag));
+}
+
+void AppendSize(std::size_t size, std::string& serialised) {
+  if (size > kMaxFieldSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
+  serialised.push_back(static_cast<char>(size & 0xFF));
+  serialised.push_back(static_cast<char>(size >> 8));
+}
+
+std::size_t ReadSize(ByteView serialised, std::size_t offset) {
+  const std::size_t size(static_cast<std::uint8_t>(serialised[offset]) |
+                         static_cast<std::uint8_t>(serialised[offset + 1]) << 8);
+  if (size == 0)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return size;
+}
+
+// Consumes the next 'size' bytes of 'fields'.
+ByteView TakeView(ByteView& fields, std::size_t size) {
+  const ByteView field(fields.substr(0, size));
+  fields.remove_prefix(size);
+  return field;
+}
+
+// The fields of a compact fob, as views into its serialised bytes.  'name' is empty unless the
+// fob is an Mpid.
+struct CompactFobFields {
+  std::uint32_t type;
+  ByteView name;
+  ByteView private_key;
+  ByteView public_key;
+  ByteView validation_token;
+};
+
+CompactFobFields ReadCompactFobFields(ByteView serialised) {
+  if (serialised.size() < kCompactFobHeaderSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  CompactFobFields fields;
+  fields.type = static_cast<std::uint8_t>(serialised[1]);
+  const std::size_t private_key_size(ReadSize(serialised, 2));
+  const std::size_t public_key_size(ReadSize(serialised, 4));
+  const std::size_t validation_token_size(ReadSize(serialised, 6));
+  const std::size_t name_size(
+      DataTagValue(fields.type) == MpidTag::kValue ? kCompactMpidNameSize : 0);
+  if (serialised.size() != kCompactFobHeaderSize + name_size + private_key_size +
+                               public_key_size + validation_token_size) {
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+
+  ByteView rest(serialised.substr(kCompactFobHeaderSize));
+  fields.name = TakeView(rest, name_size);
+  fields.private_key = TakeView(rest, private_key_size);
+  fields.public_key = TakeView(rest, public_key_size);
+  fields.validation_token = TakeView(rest, validation_token_size);
+  return fields;
+}
+
+Identity CompactFobName(const CompactFobFields& fields) {
+  if (!fields.name.empty())
+    return Identity(fields.name.to_string());
+  return CreateFobName(asymm::EncodedPublicKey(fields.public_key.to_string()),
+                       asymm::Signature(fields.validation_token.to_string()));
+}
+
+FobCereal ParseCompactFob(ByteView serialised) {
+  const CompactFobFields fields(ReadCompactFobFields(serialised));
+  FobCereal fob_cereal;
+  fob_cereal.type_ = fields.type;
+  fob_cereal.name_ = CompactFobName(fields);
+  fob_cereal.private_key_ = asymm::EncodedPrivateKey(fields.private_key.to_string());
+  fob_cereal.public_key_ = asymm::EncodedPublicKey(fields.public_key.to_string());
+  fob_cereal.validation_token_ = asymm::Signature(fields.validation_token.to_string());
+  return fob_cereal;
+}
+
+}  // unnamed namespace
+
+std::string SerialiseCompactFob(DataTagValue tag, const Identity& name,
+                                const asymm::EncodedPrivateKey& private_key,
+                                const asymm::EncodedPublicKey& public_key,
+                                const asymm::Signature& validation_token) {
+  const bool has_name(tag == MpidTag::kValue);
+  std::string serialised;
+  serialised.reserve(kCompactFobHeaderSize + (has_name ? kCompactMpidNameSize : 0) +
+                     private_key.string().size() + public_key.string().size() +
+                     validation_token.string().size());
+  AppendHeader(tag, serialised);
+  AppendSize(private_key.string().size(), serialised);
+  AppendSize(public_key.string().size(), serialised);
+  AppendSize(validation_token.string().size(), serialised);
+  if (has_name)
+    serialised += name.string();
+  serialised += private_key.string();
+  serialised += public_key.string();
+  serialised += validation_token.string();
+  return serialised;
+}
+
+FobCereal ParseFobCereal(ByteView serialised) {
+  if (IsCompactFormat(serialised))
+    return ParseCompactFob(serialised);
+  FobCereal fob_cereal;
+  try { ParseFromView(serialised, fob_cereal); }
+  catch (...) { BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error)); }
+  return fob_cereal;
+}
+
+Identity ReadFobName(ByteView serialised) {
+  try {
+    if (IsCompactFormat(serialised))
+      return CompactFobName(ReadCompactFobFields(serialised));
+    // The v1 encoding opens with the 4-byte tag, followed by the name as the first string field.
+    if (serialised.size() < sizeof(std::uint32_t))
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    ByteViewReader reader{ serialised.substr(sizeof(std::uint32_t)) };
+    return Identity(reader.ReadString().to_string());
+  }
+  catch (...) { BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error)); }
+}
+
+std::string SerialiseCompactPublicFob(DataTagValue tag, const asymm::EncodedPublicKey& public_key,
+                                      const asymm::Signature& validation_token) {
+  std::string serialised;
+  serialised.reserve(kCompactPublicFobHeaderSize + public_key.string().size() +
+                     validation_token.string().size());
+  AppendCompactPublicFob(tag, public_key, validation_token, serialised);
+  return serialised;
+}
+
+void AppendCompactPublicFob(DataTagValue tag, const asymm::EncodedPublicKey& public_key,
+                            const asymm::Signature& validation_token, std::string& serialised) {
+  AppendHeader(tag, serialised);
+  AppendSize(public_key.string().size(), serialised);
+  AppendSize(validation_token.string().size(), serialised);
+  serialised += public_key.string();
+  serialised += validation_token.string();
+}
+
+CompactPublicFobFields ReadCompactPublicFobFields(ByteView serialised) {
+  if (serialised.size() < kCompactPublicFobHeaderSize || !IsCompactFormat(serialised))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  const std::size_t public_key_size(ReadSize(serialised, 2));
+  const std::size_t validation_token_size(ReadSize(serialised, 4));
+  if (serialised.size() != kCompactPublicFobHeaderSize + public_key_size + validation_token_size)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+
+  CompactPublicFobFields fields;
+  fields.tag = DataTagValue(static_cast<std::uint8_t>(serialised[1]));
+  fields.public_key = serialised.substr(kCompactPublicFobHeaderSize, public_key_size);
+  fields.validation_token =
+      serialised.substr(kCompactPublicFobHeaderSize + public_key_size, validation_token_size);
+  return fields;
+}
+
+void ParseCompactPublicFob(DataTagValue tag, ByteView serialised,
+                           asymm::EncodedPublicKey& public_key,
+                           asymm::Signature& validation_token) {
+  const CompactPublicFobFields fields(ReadCompactPublicFobFields(serialised));
+  if (fields.tag != tag)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  public_key = asymm::EncodedPublicKey(fields.public_key.to_string());
+  validation_token = asymm::Signature(fields.validation_token.to_string());
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
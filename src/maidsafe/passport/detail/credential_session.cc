@@ -0,0 +1,198 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/credential_session.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef MAIDSAFE_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/authentication/user_credential_utils.h"
+
+#include "maidsafe/passport/detail/wipe.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace {
+
+// mlock and VirtualLock work on whole pages and don't nest, so each page is kept locked while any
+// secret on it is, and only unlocked once none are.  This stops one session unlocking a page that
+// another live session's secrets share.
+class PageLocks {
+ public:
+  static PageLocks& Instance() {
+    static PageLocks page_locks;
+    return page_locks;
+  }
+
+  // Returns false, leaving nothing locked, if any page can't be locked.
+  bool Lock(const char* address, std::size_t size) {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    const std::uintptr_t first(FirstPage(address)), last(LastPage(address, size));
+    for (std::uintptr_t page(first); page <= last; page += page_size_) {
+      if (counts_[page]++ == 0 && !LockPage(page)) {
+        Release(first, page);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Unlock(const char* address, std::size_t size) {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    Release(FirstPage(address), LastPage(address, size));
+  }
+
+ private:
+  PageLocks() : mutex_(), counts_(), page_size_(PageSize()) {}
+
+  static std::size_t PageSize() {
+#ifdef MAIDSAFE_WIN32
+    SYSTEM_INFO system_info;
+    GetSystemInfo(&system_info);
+    return system_info.dwPageSize;
+#else
+    return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  }
+
+  std::uintptr_t FirstPage(const char* address) const {
+    return reinterpret_cast<std::uintptr_t>(address) / page_size_ * page_size_;
+  }
+  std::uintptr_t LastPage(const char* address, std::size_t size) const {
+    return FirstPage(address + (size == 0 ? 0 : size - 1));
+  }
+
+  bool LockPage(std::uintptr_t page) const {
+#ifdef MAIDSAFE_WIN32
+    return VirtualLock(reinterpret_cast<void*>(page), page_size_) != 0;
+#else
+    return mlock(reinterpret_cast<void*>(page), page_size_) == 0;
+#endif
+  }
+
+  void UnlockPage(std::uintptr_t page) const {
+#ifdef MAIDSAFE_WIN32
+    VirtualUnlock(reinterpret_cast<void*>(page), page_size_);
+#else
+    munlock(reinterpret_cast<void*>(page), page_size_);
+#endif
+  }
+
+  // Drops one reference to each page in [first, last], unlocking those left unreferenced.
+  void Release(std::uintptr_t first, std::uintptr_t last) {
+    for (std::uintptr_t page(first); page <= last; page += page_size_) {
+      auto itr(counts_.find(page));
+      if (itr != std::end(counts_) && --itr->second == 0) {
+        UnlockPage(page);
+        counts_.erase(itr);
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::map<std::uintptr_t, std::size_t> counts_;
+  const std::size_t page_size_;
+};
+
+template <typename Field>
+std::unique_ptr<Field> CopyField(const std::unique_ptr<Field>& field) {
+  if (!field)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::uninitialised));
+  return maidsafe::make_unique<Field>(*field);
+}
+
+template <typename Field>
+void AddSecret(const Field* field, std::vector<const std::string*>& secrets) {
+  if (field && field->IsInitialised())
+    secrets.push_back(&field->string());
+}
+
+}  // unnamed namespace
+
+CredentialSession::CredentialSession(const authentication::UserCredentials& user_credentials)
+    : user_credentials_(), symm_key_(), symm_iv_(), memory_locked_(false) {
+  try {
+    user_credentials_.keyword = CopyField(user_credentials.keyword);
+    user_credentials_.pin = CopyField(user_credentials.pin);
+    user_credentials_.password = CopyField(user_credentials.password);
+
+    crypto::SecurePassword secure_password{
+        authentication::CreateSecurePassword(user_credentials_) };
+    symm_key_ = authentication::DeriveSymmEncryptKey(secure_password);
+    symm_iv_ = authentication::DeriveSymmEncryptIv(secure_password);
+    detail::Wipe(secure_password.string());
+  }
+  catch (...) {
+    for (const std::string* secret : Secrets())
+      detail::Wipe(*secret);
+    throw;
+  }
+
+  const std::vector<const std::string*> secrets(Secrets());
+  memory_locked_ = true;
+  for (auto itr(std::begin(secrets)); memory_locked_ && itr != std::end(secrets); ++itr) {
+    if (!PageLocks::Instance().Lock((*itr)->data(), (*itr)->size())) {
+      for (auto locked(std::begin(secrets)); locked != itr; ++locked)
+        PageLocks::Instance().Unlock((*locked)->data(), (*locked)->size());
+      memory_locked_ = false;
+    }
+  }
+  if (!memory_locked_)
+    LOG(kWarning) << "Unable to lock memory holding credentials and derived keys.";
+}
+
+CredentialSession::~CredentialSession() {
+  for (const std::string* secret : Secrets()) {
+    detail::Wipe(*secret);
+    if (memory_locked_)
+      PageLocks::Instance().Unlock(secret->data(), secret->size());
+  }
+}
+
+std::vector<const std::string*> CredentialSession::Secrets() const {
+  std::vector<const std::string*> secrets;
+  AddSecret(user_credentials_.keyword.get(), secrets);
+  AddSecret(user_credentials_.pin.get(), secrets);
+  AddSecret(user_credentials_.password.get(), secrets);
+  AddSecret(&symm_key_, secrets);
+  AddSecret(&symm_iv_, secrets);
+  return secrets;
+}
+
+NonEmptyString CredentialSession::Obfuscate(const NonEmptyString& data) const {
+  return authentication::Obfuscate(user_credentials_, data);
+}
+
+}  // namespace passport
+
+}  // namespace maidsafe
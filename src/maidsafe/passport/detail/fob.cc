@@ -18,8 +18,14 @@
 
 #include "maidsafe/passport/detail/fob.h"
 
+#include <atomic>
+#include <memory>
+
+#include "cryptopp/integer.h"
+
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/passport/detail/parallel.h"
 #include "maidsafe/passport/detail/pmid_list_cereal.h"
 #include "maidsafe/passport/detail/key_chain_list_cereal.h"
 
@@ -29,36 +35,217 @@ namespace passport {
 
 namespace detail {
 
+namespace {
+
+// Generous upper bounds on the encoded sizes of the fields of a fob.
+const std::size_t kMaxSignatureSize(1024);
+const std::size_t kMaxEncodedPublicKeySize(2048);
+const std::size_t kMaxEncodedPrivateKeySize(8192);
+
+std::atomic<std::uint64_t> g_accepted(0);
+std::atomic<std::uint64_t> g_tag_rejects(0);
+std::atomic<std::uint64_t> g_encoding_rejects(0);
+std::atomic<std::uint64_t> g_name_rejects(0);
+std::atomic<std::uint64_t> g_key_rejects(0);
+std::atomic<std::uint64_t> g_round_trips(0);
+
+void Reject(std::atomic<std::uint64_t>& stage_rejects) {
+  ++stage_rejects;
+  BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+}
+
+}  // unnamed namespace
+
 Identity CreateFobName(const asymm::PublicKey& public_key,
                        const asymm::Signature& validation_token) {
   return Identity{ crypto::Hash<crypto::SHA512>(asymm::EncodeKey(public_key) + validation_token) };
 }
 
+Identity CreateFobName(const asymm::EncodedPublicKey& encoded_public_key,
+                       const asymm::Signature& validation_token) {
+  return Identity{ crypto::Hash<crypto::SHA512>(encoded_public_key + validation_token) };
+}
+
 Identity CreateMpidName(const NonEmptyString& chosen_name) {
   return Identity{ crypto::Hash<crypto::SHA512>(chosen_name) };
 }
 
-void ValidateFobDeserialisation(DataTagValue enum_value, asymm::Keys& keys,
-                     asymm::Signature& validation_token, Identity& name, std::uint32_t type) {
-  asymm::PlainText plain{ RandomString(64) };
-  if ((enum_value != MpidTag::kValue && CreateFobName(keys.public_key, validation_token) != name)
-      || asymm::Decrypt(asymm::Encrypt(plain, keys.public_key), keys.private_key) != plain ||
-      enum_value != DataTagValue(type)) {
+bool KeysMatch(const asymm::Keys& keys) { return KeysMatch(keys.private_key, keys.public_key); }
+
+bool KeysMatch(const asymm::PrivateKey& private_key, const asymm::PublicKey& public_key) {
+  const CryptoPP::Integer& modulus(private_key.GetModulus());
+  const CryptoPP::Integer& public_exponent(private_key.GetPublicExponent());
+  if (public_key.GetModulus() != modulus || public_key.GetPublicExponent() != public_exponent) {
+    return false;
+  }
+
+  const CryptoPP::Integer& one(CryptoPP::Integer::One());
+  const CryptoPP::Integer& p(private_key.GetPrime1());
+  const CryptoPP::Integer& q(private_key.GetPrime2());
+  if (p <= one || q <= one || p * q != modulus)
+    return false;
+
+  // d mod (p-1) and d mod (q-1) must be the stored CRT exponents, each must invert e modulo its
+  // prime minus one, and the stored CRT coefficient must be the inverse of q mod p.
+  const CryptoPP::Integer& d(private_key.GetPrivateExponent());
+  const CryptoPP::Integer& dp(private_key.GetModPrime1PrivateExponent());
+  const CryptoPP::Integer& dq(private_key.GetModPrime2PrivateExponent());
+  const CryptoPP::Integer p_minus_one(p - one), q_minus_one(q - one);
+  return dp == d % p_minus_one && dq == d % q_minus_one &&
+         a_times_b_mod_c(public_exponent, dp, p_minus_one) == one &&
+         a_times_b_mod_c(public_exponent, dq, q_minus_one) == one &&
+         a_times_b_mod_c(private_key.GetMultiplicativeInverseOfPrime2ModPrime1(), q, p) == one;
+}
+
+FobKeys::FobKeys() : public_key_(), encoded_private_key_(), private_key_() {}
+
+FobKeys::FobKeys(asymm::Keys keys)
+    : public_key_(std::move(keys.public_key)),
+      encoded_private_key_(asymm::EncodeKey(keys.private_key)),
+      private_key_(std::make_shared<const asymm::PrivateKey>(std::move(keys.private_key))) {}
+
+FobKeys::FobKeys(asymm::Keys keys, asymm::EncodedPrivateKey encoded_private_key,
+                 ValidationMode mode)
+    : public_key_(std::move(keys.public_key)),
+      encoded_private_key_(std::move(encoded_private_key)),
+      private_key_(mode == ValidationMode::kDeferred
+                       ? nullptr
+                       : std::make_shared<const asymm::PrivateKey>(std::move(keys.private_key))) {}
+
+FobKeys::FobKeys(const FobKeys& other)
+    : public_key_(other.public_key_),
+      encoded_private_key_(other.encoded_private_key_),
+      private_key_(std::atomic_load(&other.private_key_)) {}
+
+FobKeys::FobKeys(FobKeys&& other)
+    : public_key_(std::move(other.public_key_)),
+      encoded_private_key_(std::move(other.encoded_private_key_)),
+      private_key_(std::move(other.private_key_)) {}
+
+void swap(FobKeys& lhs, FobKeys& rhs) {
+  using std::swap;
+  swap(lhs.public_key_, rhs.public_key_);
+  swap(lhs.encoded_private_key_, rhs.encoded_private_key_);
+  swap(lhs.private_key_, rhs.private_key_);
+}
+
+FobKeys& FobKeys::operator=(FobKeys other) {
+  swap(*this, other);
+  return *this;
+}
+
+const asymm::PrivateKey& FobKeys::private_key() const {
+  std::shared_ptr<const asymm::PrivateKey> private_key(std::atomic_load(&private_key_));
+  if (private_key)
+    return *private_key;
+
+  std::shared_ptr<const asymm::PrivateKey> decoded;
+  try {
+    decoded = std::make_shared<const asymm::PrivateKey>(asymm::DecodeKey(encoded_private_key_));
+  }
+  catch (const std::exception&) {
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
   }
+  if (!KeysMatch(*decoded, public_key_))
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  // If another thread got there first, its key is kept and returned.
+  if (std::atomic_compare_exchange_strong(&private_key_, &private_key, decoded))
+    private_key = decoded;
+  return *private_key;
+}
+
+bool FobKeys::private_key_decoded() const { return std::atomic_load(&private_key_) != nullptr; }
+
+std::vector<asymm::Signature> SignMessages(const asymm::PrivateKey& private_key,
+                                           const std::vector<asymm::PlainText>& messages,
+                                           unsigned thread_count) {
+  std::vector<asymm::Signature> signatures(messages.size());
+  ParallelFor(messages.size(), thread_count, [&](std::size_t index) {
+    signatures[index] = asymm::Sign(messages[index], private_key);
+  });
+  return signatures;
+}
+
+ValidationStatistics GetValidationStatistics() {
+  ValidationStatistics statistics;
+  statistics.accepted = g_accepted;
+  statistics.tag_rejects = g_tag_rejects;
+  statistics.encoding_rejects = g_encoding_rejects;
+  statistics.name_rejects = g_name_rejects;
+  statistics.key_rejects = g_key_rejects;
+  statistics.round_trips = g_round_trips;
+  return statistics;
+}
+
+asymm::Keys ValidateFobDeserialisation(DataTagValue enum_value, const FobCereal& fob_cereal,
+                                       ValidationMode mode) {
+  if (enum_value != DataTagValue(fob_cereal.type_))
+    Reject(g_tag_rejects);
+
+  if (!fob_cereal.name_.IsInitialised() || !fob_cereal.validation_token_.IsInitialised() ||
+      !fob_cereal.private_key_.IsInitialised() || !fob_cereal.public_key_.IsInitialised() ||
+      fob_cereal.validation_token_.string().size() > kMaxSignatureSize ||
+      fob_cereal.private_key_.string().size() > kMaxEncodedPrivateKeySize ||
+      fob_cereal.public_key_.string().size() > kMaxEncodedPublicKeySize) {
+    Reject(g_encoding_rejects);
+  }
+
+  if (enum_value != MpidTag::kValue &&
+      CreateFobName(fob_cereal.public_key_, fob_cereal.validation_token_) != fob_cereal.name_) {
+    Reject(g_name_rejects);
+  }
+
+  asymm::Keys keys;
+  try {
+    if (mode != ValidationMode::kDeferred)
+      keys.private_key = asymm::DecodeKey(fob_cereal.private_key_);
+    keys.public_key = asymm::DecodeKey(fob_cereal.public_key_);
+  }
+  catch (const std::exception&) {
+    Reject(g_encoding_rejects);
+  }
+  // Decoding accepts BER variants and trailing bytes.  The received encoding is what's retained,
+  // named and re-serialised, so it must be the canonical encoding of the key it decodes to.
+  if (asymm::EncodeKey(keys.public_key) != fob_cereal.public_key_)
+    Reject(g_encoding_rejects);
+
+  bool keys_match(false);
+  if (mode == ValidationMode::kDeferred) {
+    keys_match = true;
+  } else if (mode == ValidationMode::kKeyConsistency) {
+    keys_match = KeysMatch(keys);
+  } else {
+    ++g_round_trips;
+    asymm::PlainText plain{ RandomString(64) };
+    try {
+      keys_match =
+          asymm::Decrypt(asymm::Encrypt(plain, keys.public_key), keys.private_key) == plain;
+    }
+    catch (const std::exception&) {}
+  }
+  if (!keys_match)
+    Reject(g_key_rejects);
+
+  ++g_accepted;
+  return keys;
 }
 
 Fob<MpidTag>::Fob(const NonEmptyString& chosen_name, const Signer& signing_fob)
-    : keys_(asymm::GenerateKeyPair()),
-      validation_token_(asymm::Sign(asymm::PlainText{ asymm::EncodeKey(keys_.public_key) },
-                                    signing_fob.private_key())),
+    : keys_(KeyPool::Instance().Get()),
+      encoded_public_key_(asymm::EncodeKey(keys_.public_key())),
+      validation_token_(asymm::Sign(asymm::PlainText{ encoded_public_key_ },
+                                    signing_fob.private_key_ref())),
       name_(CreateMpidName(chosen_name)) {}
 
 Fob<MpidTag>::Fob(const Fob<MpidTag>& other)
-    : keys_(other.keys_), validation_token_(other.validation_token_), name_(other.name_) {}
+    : keys_(other.keys_),
+      encoded_public_key_(other.encoded_public_key_),
+      validation_token_(other.validation_token_),
+      name_(other.name_) {}
 
 Fob<MpidTag>::Fob(Fob<MpidTag>&& other)
     : keys_(std::move(other.keys_)),
+      encoded_public_key_(std::move(other.encoded_public_key_)),
       validation_token_(std::move(other.validation_token_)),
       name_(std::move(other.name_)) {}
 
@@ -67,8 +254,12 @@ Fob<MpidTag>& Fob<MpidTag>::operator=(Fob<MpidTag> other) {
   return *this;
 }
 
-Fob<MpidTag>::Fob(const std::string& binary_stream) : keys_(), validation_token_(), name_() {
-  try {maidsafe::ConvertFromString(binary_stream, *this);}
+Fob<MpidTag>::Fob(const std::string& binary_stream, ValidationMode mode)
+    : Fob(ByteView(binary_stream), mode) {}
+
+Fob<MpidTag>::Fob(ByteView binary_stream, ValidationMode mode)
+    : keys_(), encoded_public_key_(), validation_token_(), name_() {
+  try { FromCereal(ParseFobCereal(binary_stream), mode); }
   catch(...) {BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));}
 }
 
@@ -76,6 +267,13 @@ std::string Fob<MpidTag>::ToCereal() const {
   return maidsafe::ConvertToString(*this);
 }
 
+std::string Fob<MpidTag>::Serialise(WireFormat format) const {
+  if (format == WireFormat::kV1)
+    return ToCereal();
+  return SerialiseCompactFob(Tag::kValue, name_.value, keys_.encoded_private_key(),
+                             encoded_public_key_, validation_token_);
+}
+
 namespace {
 
 template <typename TagType>
@@ -161,12 +359,15 @@ Fob<PmidTag> ParsePmid(const NonEmptyString& serialised_pmid) {
   return Fob<PmidTag>{ serialised_pmid.string() };
 }
 
+// Reads the layout of PmidListCereal in place, parsing each Pmid straight from the file contents.
 std::vector<Fob<PmidTag>> ReadPmidList(const boost::filesystem::path& file_path) {
+  const NonEmptyString contents(ReadFile(file_path));
+  ByteViewReader reader{ ByteView(contents.string()) };
   std::vector<Fob<PmidTag>> pmid_list;
-  PmidListCereal pmid_list_msg;
-  maidsafe::ConvertFromString(ReadFile(file_path).string(), pmid_list_msg);
-  for (std::size_t i = 0; i < pmid_list_msg.pmids_.size(); ++i)
-    pmid_list.emplace_back(ParsePmid(NonEmptyString{ pmid_list_msg.pmids_[i] }));
+  const std::size_t count(reader.ReadCount(sizeof(cereal::size_type)));
+  pmid_list.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    pmid_list.emplace_back(reader.ReadString());
   return pmid_list;
 }
 
@@ -180,19 +381,27 @@ bool WritePmidList(const boost::filesystem::path& file_path,
   return WriteFile(file_path, maidsafe::ConvertToString(pmid_list_msg));
 }
 
-AnmaidToPmid ParseKeys(const KeyChainListCereal::KeyChainCereal& key_chain) {
-  return std::move(AnmaidToPmid(ParseAnmaid(NonEmptyString{ key_chain.anmaid_ }),
-                                ParseMaid(NonEmptyString{ key_chain.maid_}),
-                                ParseAnpmid(NonEmptyString{ key_chain.anpmid_ }),
-                                ParsePmid(NonEmptyString{ key_chain.pmid_ })));
+// Reads one KeyChainListCereal::KeyChainCereal in place.  The fields are read in order before
+// any is parsed, as function argument evaluation order is unspecified.
+AnmaidToPmid ParseKeys(ByteViewReader& reader) {
+  const ByteView anmaid(reader.ReadString());
+  const ByteView maid(reader.ReadString());
+  const ByteView anpmid(reader.ReadString());
+  const ByteView pmid(reader.ReadString());
+  return AnmaidToPmid(Fob<AnmaidTag>{ anmaid }, Fob<MaidTag>{ maid }, Fob<AnpmidTag>{ anpmid },
+                      Fob<PmidTag>{ pmid });
 }
 
+// Reads the layout of KeyChainListCereal in place, parsing each fob straight from the file
+// contents.
 std::vector<AnmaidToPmid> ReadKeyChainList(const boost::filesystem::path& file_path) {
+  const NonEmptyString contents(ReadFile(file_path));
+  ByteViewReader reader{ ByteView(contents.string()) };
   std::vector<AnmaidToPmid> keychain_list;
-  KeyChainListCereal keychain_list_msg;
-  maidsafe::ConvertFromString(ReadFile(file_path).string(), keychain_list_msg);
-  for (std::size_t i = 0; i < keychain_list_msg.keychains_.size(); ++i)
-    keychain_list.emplace_back(ParseKeys(keychain_list_msg.keychains_[i]));
+  const std::size_t count(reader.ReadCount(4 * sizeof(cereal::size_type)));
+  keychain_list.reserve(count);
+  for (std::size_t i = 0; i < count; ++i)
+    keychain_list.emplace_back(ParseKeys(reader));
   return keychain_list;
 }
 
@@ -0,0 +1,207 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/key_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+namespace {
+
+// Time constant of the demand estimate.  The pool aims to hold roughly this much recent demand on
+// top of the low watermark.
+const double kDemandWindowInSeconds(1.0);
+
+// How long a worker backs off after a failed key generation before trying again.
+const std::chrono::seconds kRetryInterval(1);
+
+}  // unnamed namespace
+
+KeyPool& KeyPool::Instance() {
+  static KeyPool key_pool;
+  return key_pool;
+}
+
+KeyPool::KeyPool(Config config)
+    : config_(std::move(config)),
+      keys_(),
+      workers_(),
+      in_progress_(0),
+      urgent_in_progress_(0),
+      demand_rate_(0.0),
+      last_demand_(Clock::now()),
+      statistics_(),
+      started_(false),
+      stop_(false),
+      mutex_(),
+      configure_mutex_(),
+      condition_() {
+  if (config_.low_watermark > config_.high_watermark)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+}
+
+KeyPool::~KeyPool() {
+  std::lock_guard<std::mutex> configure_lock{ configure_mutex_ };
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  StopWorkers(lock);
+}
+
+asymm::Keys KeyPool::Get() {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (!started_)
+      StartWorkers();
+    RecordDemand(Clock::now());
+    if (!keys_.empty()) {
+      asymm::Keys keys(std::move(keys_.front()));
+      keys_.pop_front();
+      ++statistics_.served_from_pool;
+      condition_.notify_all();
+      return keys;
+    }
+    ++statistics_.generated_on_demand;
+    ++urgent_in_progress_;
+  }
+
+  try {
+    asymm::Keys keys(asymm::GenerateKeyPair());
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    --urgent_in_progress_;
+    condition_.notify_all();
+    return keys;
+  }
+  catch (...) {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    --urgent_in_progress_;
+    condition_.notify_all();
+    throw;
+  }
+}
+
+void KeyPool::Configure(Config config) {
+  if (config.low_watermark > config.high_watermark)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  std::lock_guard<std::mutex> configure_lock{ configure_mutex_ };
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  const bool restart(started_);
+  StopWorkers(lock);
+  config_ = std::move(config);
+  if (keys_.size() > config_.high_watermark)
+    keys_.resize(config_.high_watermark);
+  if (restart)
+    StartWorkers();
+}
+
+KeyPool::Config KeyPool::GetConfig() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return config_;
+}
+
+std::size_t KeyPool::Size() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return keys_.size();
+}
+
+KeyPool::Statistics KeyPool::GetStatistics() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return statistics_;
+}
+
+void KeyPool::StartWorkers() {
+  started_ = true;
+  for (unsigned i(0); i != config_.thread_count; ++i)
+    workers_.emplace_back([this] { Run(); });
+}
+
+void KeyPool::StopWorkers(std::unique_lock<std::mutex>& lock) {
+  if (workers_.empty())
+    return;
+  stop_ = true;
+  condition_.notify_all();
+  std::vector<std::thread> workers;
+  workers.swap(workers_);
+  lock.unlock();
+  for (auto& worker : workers)
+    worker.join();
+  lock.lock();
+  stop_ = false;
+}
+
+void KeyPool::Run() {
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  while (!stop_) {
+    // Urgent requests are generating on their callers' threads; don't compete with them.
+    if (urgent_in_progress_ != 0 || keys_.size() + in_progress_ >= Target(Clock::now())) {
+      condition_.wait(lock);
+      continue;
+    }
+
+    ++in_progress_;
+    lock.unlock();
+    bool generated(false);
+    asymm::Keys keys;
+    try {
+      keys = asymm::GenerateKeyPair();
+      generated = true;
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Failed to pre-generate key pair: " << e.what();
+    }
+    lock.lock();
+    --in_progress_;
+
+    if (!generated) {
+      condition_.wait_for(lock, kRetryInterval, [this] { return stop_; });
+      continue;
+    }
+    if (keys_.size() < config_.high_watermark)
+      keys_.push_back(std::move(keys));
+  }
+}
+
+void KeyPool::RecordDemand(Clock::time_point now) {
+  demand_rate_ = DemandRate(now) + 1.0 / kDemandWindowInSeconds;
+  last_demand_ = now;
+}
+
+double KeyPool::DemandRate(Clock::time_point now) const {
+  const double elapsed(std::chrono::duration<double>(now - last_demand_).count());
+  return demand_rate_ * std::exp(-elapsed / kDemandWindowInSeconds);
+}
+
+std::size_t KeyPool::Target(Clock::time_point now) const {
+  const std::size_t expected_demand(
+      static_cast<std::size_t>(std::ceil(DemandRate(now) * kDemandWindowInSeconds)));
+  return std::min(config_.high_watermark, config_.low_watermark + expected_demand);
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
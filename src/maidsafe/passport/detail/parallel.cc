@@ -0,0 +1,162 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/parallel.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+namespace {
+
+// The pool whose worker is running on this thread, if any.
+thread_local const ThreadPool* t_worker_of(nullptr);
+
+unsigned ResolveThreadCount(unsigned thread_count) {
+  return thread_count == 0 ? std::max(1U, std::thread::hardware_concurrency()) : thread_count;
+}
+
+}  // unnamed namespace
+
+ThreadPool& ThreadPool::Instance() {
+  static ThreadPool thread_pool;
+  return thread_pool;
+}
+
+ThreadPool::ThreadPool(unsigned thread_count)
+    : thread_count_(ResolveThreadCount(thread_count)),
+      tasks_(),
+      workers_(),
+      started_(false),
+      stop_(false),
+      mutex_(),
+      configure_mutex_(),
+      condition_() {}
+
+ThreadPool::~ThreadPool() {
+  std::lock_guard<std::mutex> configure_lock{ configure_mutex_ };
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  StopWorkers(lock);
+}
+
+void ThreadPool::Post(std::function<void()> task) {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (!started_)
+    StartWorkers();
+  tasks_.push_back(std::move(task));
+  condition_.notify_one();
+}
+
+void ThreadPool::Configure(unsigned thread_count) {
+  // Restarting would join the calling worker, which can't finish until this call returns.
+  if (t_worker_of == this)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_argument));
+  std::lock_guard<std::mutex> configure_lock{ configure_mutex_ };
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  const bool restart(started_);
+  StopWorkers(lock);
+  thread_count_ = ResolveThreadCount(thread_count);
+  if (restart)
+    StartWorkers();
+}
+
+unsigned ThreadPool::GetThreadCount() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  return thread_count_;
+}
+
+void ThreadPool::StartWorkers() {
+  started_ = true;
+  for (unsigned i(0); i != thread_count_; ++i)
+    workers_.emplace_back([this] { Run(); });
+}
+
+void ThreadPool::StopWorkers(std::unique_lock<std::mutex>& lock) {
+  if (workers_.empty())
+    return;
+  stop_ = true;
+  condition_.notify_all();
+  std::vector<std::thread> workers;
+  workers.swap(workers_);
+  lock.unlock();
+  for (auto& worker : workers)
+    worker.join();
+  lock.lock();
+  stop_ = false;
+}
+
+void ThreadPool::Run() {
+  t_worker_of = this;
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  while (!stop_) {
+    if (tasks_.empty()) {
+      condition_.wait(lock);
+      continue;
+    }
+    std::function<void()> task(std::move(tasks_.front()));
+    tasks_.pop_front();
+    lock.unlock();
+    try {
+      task();
+    }
+    catch (const std::exception& e) {
+      LOG(kError) << "Thread pool task threw: " << e.what();
+    }
+    catch (...) {
+      LOG(kError) << "Thread pool task threw.";
+    }
+    lock.lock();
+  }
+}
+
+LoopHelpers::LoopHelpers(std::function<void()> loop)
+    : loop_(std::move(loop)), running_(0), closed_(false), mutex_(), condition_() {}
+
+void LoopHelpers::Help() {
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    if (closed_)
+      return;
+    ++running_;
+  }
+  loop_();
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (--running_ == 0)
+    condition_.notify_all();
+}
+
+void LoopHelpers::Close() {
+  std::unique_lock<std::mutex> lock{ mutex_ };
+  closed_ = true;
+  condition_.wait(lock, [this] { return running_ == 0; });
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
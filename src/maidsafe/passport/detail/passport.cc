@@ -18,13 +18,19 @@
 
 #include "maidsafe/passport/passport.h"
 
+#include <cstdint>
+#include <mutex>
+#include <string>
+
 #include "maidsafe/common/make_unique.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/authentication/user_credentials.h"
-#include "maidsafe/common/authentication/user_credential_utils.h"
 
 #include "maidsafe/common/serialisation/serialisation.h"
+#include "maidsafe/passport/detail/parallel.h"
 #include "maidsafe/passport/detail/passport_cereal.h"
+#include "maidsafe/passport/detail/serialisation_buffer.h"
+#include "maidsafe/passport/detail/wipe.h"
 
 namespace maidsafe {
 
@@ -32,49 +38,203 @@ namespace passport {
 
 namespace {
 
-template <typename Key>
-void CheckThenAddKeyAndSigner(std::vector<std::pair<Key, typename Key::Signer>>& keys_and_signers,
-                              std::mutex& mutex,
-                              std::pair<Key, typename Key::Signer> key_and_signer) {
-  std::lock_guard<std::mutex> lock{ mutex };
-  if (std::any_of(std::begin(keys_and_signers), std::end(keys_and_signers),
-                  [&](const std::pair<Key, typename Key::Signer>& existing_pair) {
-                    return key_and_signer.first.name() == existing_pair.first.name() ||
-                           key_and_signer.second.name() == existing_pair.second.name();
-                  })) {
-    LOG(kError) << "Key or signer already exists in passport - use unique keys and signers.";
-    BOOST_THROW_EXCEPTION(MakeError(PassportErrors::id_already_exists));
+// Prefixes envelope-format encrypted passports.  A direct-format ciphertext starts with this by
+// chance with negligible probability.
+const std::string kEnvelopeMagic("MSPENVLP", 8);
+const std::uint32_t kEnvelopeVersion(1);
+
+bool IsEnvelope(const crypto::CipherText& encrypted_passport) {
+  const std::string& cipher_text(encrypted_passport->string());
+  return cipher_text.size() > kEnvelopeMagic.size() &&
+         cipher_text.compare(0, kEnvelopeMagic.size(), kEnvelopeMagic) == 0;
+}
+
+detail::PassportEnvelopeCereal ParseEnvelope(const crypto::CipherText& encrypted_passport) {
+  detail::PassportEnvelopeCereal envelope;
+  try {
+    maidsafe::ConvertFromString(encrypted_passport->string().substr(kEnvelopeMagic.size()),
+                                envelope);
+  }
+  catch (...) {
+    LOG(kError) << "Failed to parse passport envelope.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
   }
-  keys_and_signers.emplace_back(std::move(key_and_signer));
+  if (envelope.version_ != kEnvelopeVersion) {
+    LOG(kError) << "Unsupported passport envelope version " << envelope.version_;
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  }
+  return envelope;
+}
+
+crypto::CipherText SerialiseEnvelope(const detail::PassportEnvelopeCereal& envelope) {
+  return crypto::CipherText{ NonEmptyString{ kEnvelopeMagic +
+                                             maidsafe::ConvertToString(envelope) } };
+}
+
+// The data key is held as the AES key followed by the IV.
+std::string WrapDataKey(const std::string& data_key, const CredentialSession& session) {
+  return crypto::SymmEncrypt(session.Obfuscate(NonEmptyString{ data_key }), session.symm_key(),
+                             session.symm_iv())->string();
+}
+
+std::string UnwrapDataKey(const std::string& wrapped_data_key, const CredentialSession& session) {
+  std::string data_key(session.Obfuscate(crypto::SymmDecrypt(
+      crypto::CipherText{ NonEmptyString{ wrapped_data_key } }, session.symm_key(),
+      session.symm_iv())).string());
+  if (data_key.size() != crypto::AES256_KeySize + crypto::AES256_IVSize)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+  return data_key;
 }
 
+crypto::AES256Key DataKey(const std::string& data_key) {
+  return crypto::AES256Key{ data_key.substr(0, crypto::AES256_KeySize) };
+}
+
+crypto::AES256InitialisationVector DataIv(const std::string& data_key) {
+  return crypto::AES256InitialisationVector{ data_key.substr(crypto::AES256_KeySize) };
+}
+
+// Wipes 'buffer' when it goes out of scope.
+class WipeOnExit {
+ public:
+  explicit WipeOnExit(detail::SerialisationBuffer& buffer) : buffer_(buffer) {}
+  ~WipeOnExit() { buffer_.Wipe(); }
+
+ private:
+  WipeOnExit(const WipeOnExit&) = delete;
+  WipeOnExit(WipeOnExit&&) = delete;
+  WipeOnExit& operator=(WipeOnExit) = delete;
+
+  detail::SerialisationBuffer& buffer_;
+};
+
+// Replaces 'keys_and_signers' with a copy to which 'key_and_signer' has been added.  The copy
+// shares all but the O(log N) nodes which the addition touches.
 template <typename Key>
-std::vector<Key> GetKeys(const std::vector<std::pair<Key, typename Key::Signer>>& keys_and_signers,
-                         std::mutex& mutex) {
-  std::vector<Key> keys;
-  std::lock_guard<std::mutex> lock{ mutex };
-  for (const auto& key_and_signer : keys_and_signers)
-    keys.push_back(key_and_signer.first);
-  return keys;
+void CheckThenAddKeyAndSigner(
+    std::shared_ptr<const detail::KeysAndSigners<Key>>& keys_and_signers,
+    std::pair<Key, typename Key::Signer> key_and_signer) {
+  auto updated(std::make_shared<detail::KeysAndSigners<Key>>(*keys_and_signers));
+  if (!updated->Add(std::move(key_and_signer))) {
+    LOG(kError) << "Key or signer already exists in passport - use unique keys and signers.";
+    BOOST_THROW_EXCEPTION(MakeError(PassportErrors::id_already_exists));
+  }
+  keys_and_signers = std::move(updated);
 }
 
+// Replaces 'keys_and_signers' with a copy from which 'key_to_be_removed' has been removed.
 template <typename Key>
 typename Key::Signer RemovePassportKeyAndSigner(
-    std::vector<std::pair<Key, typename Key::Signer>>& keys_and_signers,
-    std::mutex& mutex,
+    std::shared_ptr<const detail::KeysAndSigners<Key>>& keys_and_signers,
     const Key& key_to_be_removed) {
-  std::lock_guard<std::mutex> lock{ mutex };
-  auto itr(std::find_if(std::begin(keys_and_signers), std::end(keys_and_signers),
-                        [&](const std::pair<Key, typename Key::Signer>& existing_pair) {
-                          return key_to_be_removed.name() == existing_pair.first.name();
-                        }));
-  if (itr == std::end(keys_and_signers))
+  auto itr(keys_and_signers->Find(key_to_be_removed.name_ref()));
+  if (itr == std::end(*keys_and_signers))
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  typename Key::Signer signer{ std::move(itr->second) };
-  keys_and_signers.erase(itr);
+  typename Key::Signer signer{ itr->Get().second };
+  auto updated(std::make_shared<detail::KeysAndSigners<Key>>(*keys_and_signers));
+  updated->Remove(itr);
+  keys_and_signers = std::move(updated);
   return signer;
 }
 
+// The caches enabled by ConfigureParseCache, one per fob type a passport holds.
+struct ParseCaches {
+  explicit ParseCaches(std::size_t memory_limit)
+      : maid(memory_limit), anmaid(memory_limit), pmid(memory_limit), anpmid(memory_limit),
+        mpid(memory_limit), anmpid(memory_limit) {}
+  detail::FobCache<Maid> maid;
+  detail::FobCache<Anmaid> anmaid;
+  detail::FobCache<Pmid> pmid;
+  detail::FobCache<Anpmid> anpmid;
+  detail::FobCache<Mpid> mpid;
+  detail::FobCache<Anmpid> anmpid;
+};
+
+detail::FobCache<Maid>& Cache(ParseCaches& caches, const Maid*) { return caches.maid; }
+detail::FobCache<Anmaid>& Cache(ParseCaches& caches, const Anmaid*) { return caches.anmaid; }
+detail::FobCache<Pmid>& Cache(ParseCaches& caches, const Pmid*) { return caches.pmid; }
+detail::FobCache<Anpmid>& Cache(ParseCaches& caches, const Anpmid*) { return caches.anpmid; }
+detail::FobCache<Mpid>& Cache(ParseCaches& caches, const Mpid*) { return caches.mpid; }
+detail::FobCache<Anmpid>& Cache(ParseCaches& caches, const Anmpid*) { return caches.anmpid; }
+
+// Null while the caches are disabled.  Read and replaced atomically, so a parse in progress keeps
+// the caches it started with.
+std::shared_ptr<ParseCaches>& ParseCachesInstance() {
+  static std::shared_ptr<ParseCaches> parse_caches;
+  return parse_caches;
+}
+
+template <typename FobType>
+FobType ParseFob(detail::ByteView serialised, detail::ValidationMode mode, ParseCaches* caches) {
+  if (!caches)
+    return FobType{ serialised, mode };
+  return *Cache(*caches, static_cast<const FobType*>(nullptr))
+              .Parse(serialised.to_string(), mode);
+}
+
+template <typename Key>
+std::unique_ptr<std::pair<Key, typename Key::Signer>> ParseKeyAndSigner(
+    const detail::KeyAndSignerView& key_and_signer, detail::ValidationMode key_validation,
+    detail::ValidationMode signer_validation, ParseCaches* caches) {
+  return maidsafe::make_unique<std::pair<Key, typename Key::Signer>>(
+      ParseFob<Key>(key_and_signer.key_, key_validation, caches),
+      ParseFob<typename Key::Signer>(key_and_signer.signer_, signer_validation, caches));
+}
+
+template <typename Key>
+std::shared_ptr<const detail::KeysAndSigners<Key>> AddParsedKeysAndSigners(
+    std::vector<std::unique_ptr<std::pair<Key, typename Key::Signer>>>& parsed) {
+  auto keys_and_signers(std::make_shared<detail::KeysAndSigners<Key>>());
+  for (auto& key_and_signer : parsed) {
+    if (!keys_and_signers->Add(std::move(*key_and_signer))) {
+      LOG(kError) << "Serialised passport contains a duplicate key or signer.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  return keys_and_signers;
+}
+
+template <typename Key>
+std::shared_ptr<const detail::KeysAndSigners<Key>> AddSerialisedKeysAndSigners(
+    const std::vector<detail::KeyAndSignerView>& serialised_keys_and_signers,
+    detail::ValidationMode key_validation, detail::ValidationMode signer_validation) {
+  auto keys_and_signers(std::make_shared<detail::KeysAndSigners<Key>>());
+  for (const auto& serialised : serialised_keys_and_signers) {
+    if (!keys_and_signers->AddSerialised(serialised.key_.to_string(),
+                                         serialised.signer_.to_string(), key_validation,
+                                         signer_validation)) {
+      LOG(kError) << "Serialised passport contains a duplicate key or signer.";
+      BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+    }
+  }
+  return keys_and_signers;
+}
+
+// Writes 'keys_and_signers' as a std::vector<detail::KeyAndSignerCereal> would be written.
+template <typename Key>
+void WriteKeysAndSigners(const detail::KeysAndSigners<Key>& keys_and_signers,
+                         detail::SerialisationBuffer& buffer) {
+  buffer.Write(static_cast<cereal::size_type>(keys_and_signers.size()));
+  for (const auto& entry : keys_and_signers) {
+    entry.WriteKey(buffer);
+    entry.WriteSigner(buffer);
+  }
+}
+
+template <typename KeyAndSigner, typename Create>
+std::vector<KeyAndSigner> CreateKeysAndSigners(std::size_t count, unsigned thread_count,
+                                               const Create& create) {
+  std::vector<std::unique_ptr<KeyAndSigner>> created(count);
+  detail::ParallelFor(count, thread_count, [&](std::size_t index) {
+    created[index] = maidsafe::make_unique<KeyAndSigner>(create(index));
+  });
+  std::vector<KeyAndSigner> keys_and_signers;
+  keys_and_signers.reserve(count);
+  for (auto& key_and_signer : created)
+    keys_and_signers.emplace_back(std::move(*key_and_signer));
+  return keys_and_signers;
+}
+
 }  // unnamed namespace
 
 crypto::CipherText EncryptMaid(const Maid& maid, const crypto::AES256Key& symm_key,
@@ -107,6 +267,33 @@ Pmid DecryptPmid(const crypto::CipherText& encrypted_pmid, const crypto::AES256K
   return detail::DecryptPmid(encrypted_pmid, symm_key, symm_iv);
 }
 
+void ConfigureParseCache(std::size_t memory_limit) {
+  std::shared_ptr<ParseCaches> caches;
+  if (memory_limit != 0)
+    caches = std::make_shared<ParseCaches>(memory_limit);
+  std::atomic_store(&ParseCachesInstance(), caches);
+}
+
+detail::FobCacheStatistics GetParseCacheStatistics() {
+  detail::FobCacheStatistics totals = {};
+  const std::shared_ptr<ParseCaches> caches(std::atomic_load(&ParseCachesInstance()));
+  if (!caches)
+    return totals;
+  auto add([&totals](const detail::FobCacheStatistics& statistics) {
+    totals.hits += statistics.hits;
+    totals.misses += statistics.misses;
+    totals.entry_count += statistics.entry_count;
+    totals.memory_usage += statistics.memory_usage;
+  });
+  add(caches->maid.GetStatistics());
+  add(caches->anmaid.GetStatistics());
+  add(caches->pmid.GetStatistics());
+  add(caches->anpmid.GetStatistics());
+  add(caches->mpid.GetStatistics());
+  add(caches->anmpid.GetStatistics());
+  return totals;
+}
+
 MaidAndSigner CreateMaidAndSigner() {
   Maid::Signer signer;
   return std::make_pair(Maid{ signer }, signer);
@@ -122,147 +309,330 @@ MpidAndSigner CreateMpidAndSigner(const NonEmptyString& chosen_name) {
   return std::make_pair(Mpid{ chosen_name, signer }, signer);
 }
 
+std::vector<MaidAndSigner> CreateMaidAndSignerBatch(std::size_t count, unsigned thread_count) {
+  return CreateKeysAndSigners<MaidAndSigner>(count, thread_count,
+                                             [](std::size_t) { return CreateMaidAndSigner(); });
+}
+
+std::vector<PmidAndSigner> CreatePmidAndSignerBatch(std::size_t count, unsigned thread_count) {
+  return CreateKeysAndSigners<PmidAndSigner>(count, thread_count,
+                                             [](std::size_t) { return CreatePmidAndSigner(); });
+}
+
+std::vector<MpidAndSigner> CreateMpidAndSignerBatch(
+    const std::vector<NonEmptyString>& chosen_names, unsigned thread_count) {
+  return CreateKeysAndSigners<MpidAndSigner>(chosen_names.size(), thread_count,
+      [&](std::size_t index) { return CreateMpidAndSigner(chosen_names[index]); });
+}
+
+crypto::CipherText RewrapPassport(const crypto::CipherText& encrypted_passport,
+                                  const CredentialSession& old_session,
+                                  const CredentialSession& new_session) {
+  if (!IsEnvelope(encrypted_passport)) {
+    LOG(kError) << "Only envelope-format passports can be rewrapped.";
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::invalid_parameter));
+  }
+  detail::PassportEnvelopeCereal envelope(ParseEnvelope(encrypted_passport));
+  envelope.wrapped_data_key_ =
+      WrapDataKey(UnwrapDataKey(envelope.wrapped_data_key_, old_session), new_session);
+  return SerialiseEnvelope(envelope);
+}
+
+Passport::Snapshot::Snapshot()
+    : generation_(0),
+      maid_and_signer_(),
+      pmids_and_signers_(std::make_shared<const detail::KeysAndSigners<Pmid>>()),
+      mpids_and_signers_(std::make_shared<const detail::KeysAndSigners<Mpid>>()) {}
+
+const Maid& Passport::Snapshot::GetMaid() const {
+  if (!maid_and_signer_)
+    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
+  return maid_and_signer_->first;
+}
+
+Passport::Snapshot::PmidRange Passport::Snapshot::GetPmids() const {
+  return PmidRange(pmids_and_signers_->keys_begin(), pmids_and_signers_->keys_end());
+}
+
+Passport::Snapshot::MpidRange Passport::Snapshot::GetMpids() const {
+  return MpidRange(mpids_and_signers_->keys_begin(), mpids_and_signers_->keys_end());
+}
+
+const Pmid* Passport::Snapshot::FindPmid(const Pmid::Name& name) const {
+  auto itr(pmids_and_signers_->Find(name));
+  return itr == std::end(*pmids_and_signers_) ? nullptr : &itr->Get().first;
+}
+
+const Mpid* Passport::Snapshot::FindMpid(const Mpid::Name& name) const {
+  auto itr(mpids_and_signers_->Find(name));
+  return itr == std::end(*mpids_and_signers_) ? nullptr : &itr->Get().first;
+}
+
 Passport::Passport(MaidAndSigner maid_and_signer)
-    : maid_and_signer_(maidsafe::make_unique<MaidAndSigner>(std::move(maid_and_signer))),
-      pmids_and_signers_(),
-      mpids_and_signers_(),
-      mutex_() {}
+    : snapshot_(),
+      maid_mutex_(),
+      pmids_mutex_(),
+      mpids_mutex_(),
+      serialised_(),
+      serialised_generation_(0),
+      serialisation_statistics_(),
+      serialised_mutex_() {
+  std::shared_ptr<Snapshot> snapshot(new Snapshot);
+  snapshot->maid_and_signer_ = std::make_shared<const MaidAndSigner>(std::move(maid_and_signer));
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
 
 Passport::Passport(const crypto::CipherText& encrypted_passport,
-                   const authentication::UserCredentials& user_credentials)
-    : maid_and_signer_(),
-      pmids_and_signers_(),
-      mpids_and_signers_(),
-      mutex_() {
-  crypto::SecurePassword secure_password{ authentication::CreateSecurePassword(user_credentials) };
-  Parse(authentication::Obfuscate(
-            user_credentials,
-            crypto::SymmDecrypt(encrypted_passport,
-                                authentication::DeriveSymmEncryptKey(secure_password),
-                                authentication::DeriveSymmEncryptIv(secure_password))));
-}
-
-void Passport::Parse(const NonEmptyString& serialised_passport) {
-  detail::PassportCereal cereal_passport;
-  try { maidsafe::ConvertFromString(serialised_passport.string(), cereal_passport); }
+                   const authentication::UserCredentials& user_credentials, LoadMode load_mode,
+                   detail::ValidationMode key_validation, SignerValidation signer_validation)
+    : Passport(encrypted_passport, CredentialSession{ user_credentials }, load_mode,
+               key_validation, signer_validation) {}
+
+Passport::Passport(const crypto::CipherText& encrypted_passport, const CredentialSession& session,
+                   LoadMode load_mode, detail::ValidationMode key_validation,
+                   SignerValidation signer_validation)
+    : snapshot_(),
+      maid_mutex_(),
+      pmids_mutex_(),
+      mpids_mutex_(),
+      serialised_(),
+      serialised_generation_(0),
+      serialisation_statistics_(),
+      serialised_mutex_() {
+  const detail::ValidationMode signer_mode(signer_validation == SignerValidation::kDefer
+                                               ? detail::ValidationMode::kDeferred
+                                               : key_validation);
+  if (IsEnvelope(encrypted_passport)) {
+    const detail::PassportEnvelopeCereal envelope(ParseEnvelope(encrypted_passport));
+    const std::string data_key(UnwrapDataKey(envelope.wrapped_data_key_, session));
+    Parse(crypto::SymmDecrypt(crypto::CipherText{ NonEmptyString{ envelope.body_ } },
+                              DataKey(data_key), DataIv(data_key)),
+          load_mode, key_validation, signer_mode);
+  } else {
+    Parse(session.Obfuscate(
+              crypto::SymmDecrypt(encrypted_passport, session.symm_key(), session.symm_iv())),
+          load_mode, key_validation, signer_mode);
+  }
+}
+
+template <typename Update>
+void Passport::Publish(const Update& update) {
+  std::shared_ptr<const Snapshot> current(std::atomic_load(&snapshot_)), next;
+  do {
+    auto updated(std::make_shared<Snapshot>(*current));
+    ++updated->generation_;
+    update(*updated);
+    next = std::move(updated);
+  } while (!std::atomic_compare_exchange_weak(&snapshot_, &current, next));
+}
+
+void Passport::Parse(const NonEmptyString& serialised_passport, LoadMode load_mode,
+                     detail::ValidationMode key_validation,
+                     detail::ValidationMode signer_validation) {
+  // The fobs are parsed straight from 'serialised_passport'; only entries held lazily are copied.
+  detail::PassportView passport_view;
+  try { passport_view = detail::ParsePassportView(serialised_passport.string()); }
   catch(...) {
     LOG(kError) << "Failed to parse passport.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
   }
 
-  std::lock_guard<std::mutex> lock{ mutex_ };
+  const std::shared_ptr<ParseCaches> caches(std::atomic_load(&ParseCachesInstance()));
+  std::shared_ptr<Snapshot> snapshot(new Snapshot);
+  if (load_mode == LoadMode::kLazy) {
+    snapshot->maid_and_signer_ = ParseKeyAndSigner<Maid>(
+        passport_view.maid_and_signer_, key_validation, signer_validation, caches.get());
+    snapshot->pmids_and_signers_ = AddSerialisedKeysAndSigners<Pmid>(
+        passport_view.pmids_and_signers_, key_validation, signer_validation);
+    snapshot->mpids_and_signers_ = AddSerialisedKeysAndSigners<Mpid>(
+        passport_view.mpids_and_signers_, key_validation, signer_validation);
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+    return;
+  }
 
-  maid_and_signer_ = maidsafe::make_unique<MaidAndSigner>(std::make_pair(
-    Maid{ cereal_passport.maid_and_signer_.key_ },
-    Anmaid{ cereal_passport.maid_and_signer_.signer_ }));
+  // Each entry costs two key decodes and validations, so reconstruct them across all cores.
+  // Results are slotted by index and ParallelFor reports the error for the lowest failing index, so
+  // the order and any error are independent of scheduling.  Index 0 is the Maid, then the Pmids,
+  // then the Mpids.
+  const std::size_t pmid_count(passport_view.pmids_and_signers_.size());
+  const std::size_t mpid_count(passport_view.mpids_and_signers_.size());
+  std::unique_ptr<MaidAndSigner> maid_and_signer;
+  std::vector<std::unique_ptr<PmidAndSigner>> pmids_and_signers(pmid_count);
+  std::vector<std::unique_ptr<MpidAndSigner>> mpids_and_signers(mpid_count);
+  detail::ParallelFor(1 + pmid_count + mpid_count, 0, [&](std::size_t index) {
+    if (index == 0) {
+      maid_and_signer = ParseKeyAndSigner<Maid>(passport_view.maid_and_signer_, key_validation,
+                                                signer_validation, caches.get());
+    } else if (index <= pmid_count) {
+      pmids_and_signers[index - 1] =
+          ParseKeyAndSigner<Pmid>(passport_view.pmids_and_signers_[index - 1], key_validation,
+                                  signer_validation, caches.get());
+    } else {
+      mpids_and_signers[index - 1 - pmid_count] = ParseKeyAndSigner<Mpid>(
+          passport_view.mpids_and_signers_[index - 1 - pmid_count], key_validation,
+          signer_validation, caches.get());
+    }
+  });
+
+  snapshot->maid_and_signer_ = std::move(maid_and_signer);
+  snapshot->pmids_and_signers_ = AddParsedKeysAndSigners(pmids_and_signers);
+  snapshot->mpids_and_signers_ = AddParsedKeysAndSigners(mpids_and_signers);
+
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
 
-  for (std::size_t i(0); i != cereal_passport.pmids_and_signers_.size(); ++i) {
-    pmids_and_signers_.emplace_back(std::make_pair(
-      Pmid{ cereal_passport.pmids_and_signers_[i].key_ },
-      Anpmid{ cereal_passport.pmids_and_signers_[i].signer_ }));
+std::shared_ptr<const NonEmptyString> Passport::Serialise() const {
+  const Snapshot snapshot(GetSnapshot());
+  std::size_t size_hint(0);
+  {
+    std::lock_guard<std::mutex> lock{ serialised_mutex_ };
+    if (serialised_ && serialised_generation_ == snapshot.generation_) {
+      ++serialisation_statistics_.cache_hits;
+      return serialised_;
+    }
+    // The previous version's size is usually close enough to avoid regrowing the buffer.
+    if (serialised_)
+      size_hint = serialised_->string().size() + serialised_->string().size() / 8;
   }
 
-  for (std::size_t j(0); j != cereal_passport.mpids_and_signers_.size(); ++j) {
-    mpids_and_signers_.emplace_back(std::make_pair(
-      Mpid{ cereal_passport.mpids_and_signers_[j].key_ },
-      Anmpid{ cereal_passport.mpids_and_signers_[j].signer_ }));
+  // Build without holding the lock so that a rebuild doesn't block readers of the cached version.
+  std::shared_ptr<const NonEmptyString> serialised(SerialiseSnapshot(snapshot, size_hint));
+  std::lock_guard<std::mutex> lock{ serialised_mutex_ };
+  ++serialisation_statistics_.rebuilds;
+  if (!serialised_ || snapshot.generation_ > serialised_generation_) {
+    serialised_ = serialised;
+    serialised_generation_ = snapshot.generation_;
   }
+  return serialised;
 }
 
-NonEmptyString Passport::Serialise() const {
-  detail::PassportCereal cereal_passport;
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  if (!maid_and_signer_) {
+std::shared_ptr<const NonEmptyString> Passport::SerialiseSnapshot(const Snapshot& snapshot,
+                                                                  std::size_t size_hint) {
+  if (!snapshot.maid_and_signer_) {
     LOG(kError) << "Passport must contain a Maid in order to be serialised.";
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::serialisation_error));
   }
 
-  detail::KeyAndSignerCereal* cereal_key_and_signer{ &cereal_passport.maid_and_signer_ };
-  cereal_key_and_signer->key_ = maid_and_signer_->first.ToCereal();
-  cereal_key_and_signer->signer_ = maid_and_signer_->second.ToCereal();
+  // Writes the layout of detail::PassportCereal in a single pass, with each fob serialised straight
+  // into its string field rather than into an intermediate string which is then copied.  Each
+  // thread reuses one buffer, so once it has grown to fit, a rebuild allocates only the returned
+  // string.  The buffer holds private keys, so it's wiped however this returns, and its contents
+  // are copied once, straight into storage which is wiped when released.
+  thread_local detail::SerialisationBuffer buffer;
+  const WipeOnExit wipe_on_exit(buffer);
+  buffer.Reserve(size_hint);
+  buffer.WriteString([&](detail::SerialisationBuffer&) {
+    snapshot.maid_and_signer_->first.SerialiseInto(buffer);
+  });
+  buffer.WriteString([&](detail::SerialisationBuffer&) {
+    snapshot.maid_and_signer_->second.SerialiseInto(buffer);
+  });
+  WriteKeysAndSigners(*snapshot.pmids_and_signers_, buffer);
+  WriteKeysAndSigners(*snapshot.mpids_and_signers_, buffer);
+  return detail::MakeWipedOnRelease(buffer.string());
+}
 
-  for (const auto& pmid_and_signer : pmids_and_signers_) {
-    cereal_key_and_signer = ((cereal_passport.pmids_and_signers_.emplace_back(),
-                             &cereal_passport.pmids_and_signers_[
-                             cereal_passport.pmids_and_signers_.size() - 1]));
-    cereal_key_and_signer->key_ = pmid_and_signer.first.ToCereal();
-    cereal_key_and_signer->signer_ = pmid_and_signer.second.ToCereal();
-  }
+crypto::CipherText Passport::Encrypt(const authentication::UserCredentials& user_credentials,
+                                     EncryptionFormat format) const {
+  return Encrypt(CredentialSession{ user_credentials }, format);
+}
 
-  for (const auto& mpid_and_signer : mpids_and_signers_) {
-    cereal_key_and_signer = ((cereal_passport.mpids_and_signers_.emplace_back(),
-                              &cereal_passport.mpids_and_signers_[
-                              cereal_passport.mpids_and_signers_.size() - 1]));
-    cereal_key_and_signer->key_ = mpid_and_signer.first.ToCereal();
-    cereal_key_and_signer->signer_ = mpid_and_signer.second.ToCereal();
+crypto::CipherText Passport::Encrypt(const CredentialSession& session,
+                                     EncryptionFormat format) const {
+  if (format == EncryptionFormat::kDirect) {
+    return crypto::SymmEncrypt(session.Obfuscate(*Serialise()), session.symm_key(),
+                               session.symm_iv());
   }
 
-  return NonEmptyString{ maidsafe::ConvertToString(cereal_passport) };
+  const std::string data_key(RandomString(crypto::AES256_KeySize + crypto::AES256_IVSize));
+  detail::PassportEnvelopeCereal envelope;
+  envelope.version_ = kEnvelopeVersion;
+  envelope.wrapped_data_key_ = WrapDataKey(data_key, session);
+  envelope.body_ = crypto::SymmEncrypt(*Serialise(), DataKey(data_key), DataIv(data_key))->string();
+  return SerialiseEnvelope(envelope);
+}
+
+Passport::Snapshot Passport::GetSnapshot() const {
+  return *std::atomic_load(&snapshot_);
 }
 
-crypto::CipherText Passport::Encrypt(
-    const authentication::UserCredentials& user_credentials) const {
-  crypto::SecurePassword secure_password{ authentication::CreateSecurePassword(user_credentials) };
-  return crypto::SymmEncrypt(
-      authentication::Obfuscate(user_credentials, Serialise()),
-      authentication::DeriveSymmEncryptKey(secure_password),
-      authentication::DeriveSymmEncryptIv(secure_password));
+Passport::SerialisationStatistics Passport::GetSerialisationStatistics() const {
+  std::lock_guard<std::mutex> lock{ serialised_mutex_ };
+  return serialisation_statistics_;
 }
 
 Maid Passport::GetMaid() const {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  if (!maid_and_signer_)
-    BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  return maid_and_signer_->first;
+  return GetSnapshot().GetMaid();
 }
 
 void Passport::AddKeyAndSigner(PmidAndSigner pmid_and_signer) {
-  CheckThenAddKeyAndSigner(pmids_and_signers_, mutex_, pmid_and_signer);
+  std::lock_guard<std::mutex> lock{ pmids_mutex_ };
+  auto pmids_and_signers(std::atomic_load(&snapshot_)->pmids_and_signers_);
+  CheckThenAddKeyAndSigner(pmids_and_signers, std::move(pmid_and_signer));
+  Publish([&](Snapshot& snapshot) { snapshot.pmids_and_signers_ = pmids_and_signers; });
 }
 
 void Passport::AddKeyAndSigner(MpidAndSigner mpid_and_signer) {
-  CheckThenAddKeyAndSigner(mpids_and_signers_, mutex_, mpid_and_signer);
+  std::lock_guard<std::mutex> lock{ mpids_mutex_ };
+  auto mpids_and_signers(std::atomic_load(&snapshot_)->mpids_and_signers_);
+  CheckThenAddKeyAndSigner(mpids_and_signers, std::move(mpid_and_signer));
+  Publish([&](Snapshot& snapshot) { snapshot.mpids_and_signers_ = mpids_and_signers; });
 }
 
 std::vector<Pmid> Passport::GetPmids() const {
-  return GetKeys(pmids_and_signers_, mutex_);
+  const Snapshot snapshot(GetSnapshot());
+  auto pmids(snapshot.GetPmids());
+  return std::vector<Pmid>(std::begin(pmids), std::end(pmids));
 }
 
 std::vector<Mpid> Passport::GetMpids() const {
-  return GetKeys(mpids_and_signers_, mutex_);
+  const Snapshot snapshot(GetSnapshot());
+  auto mpids(snapshot.GetMpids());
+  return std::vector<Mpid>(std::begin(mpids), std::end(mpids));
 }
 
 template <>
 Maid::Signer Passport::RemoveKeyAndSigner<Maid>(const Maid& key_to_be_removed) {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  if (!maid_and_signer_ || maid_and_signer_->first.name() != key_to_be_removed.name())
+  std::lock_guard<std::mutex> lock{ maid_mutex_ };
+  auto maid_and_signer(std::atomic_load(&snapshot_)->maid_and_signer_);
+  if (!maid_and_signer || maid_and_signer->first.name_ref() != key_to_be_removed.name_ref())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  Maid::Signer signer{ std::move(maid_and_signer_->second) };
-  maid_and_signer_.reset();
+  Maid::Signer signer{ maid_and_signer->second };
+  Publish([](Snapshot& snapshot) { snapshot.maid_and_signer_.reset(); });
   return signer;
 }
 
 template <>
 Pmid::Signer Passport::RemoveKeyAndSigner<Pmid>(const Pmid& key_to_be_removed) {
-  return RemovePassportKeyAndSigner(pmids_and_signers_, mutex_, key_to_be_removed);
+  std::lock_guard<std::mutex> lock{ pmids_mutex_ };
+  auto pmids_and_signers(std::atomic_load(&snapshot_)->pmids_and_signers_);
+  Pmid::Signer signer{ RemovePassportKeyAndSigner(pmids_and_signers, key_to_be_removed) };
+  Publish([&](Snapshot& snapshot) { snapshot.pmids_and_signers_ = pmids_and_signers; });
+  return signer;
 }
 
 template <>
 Mpid::Signer Passport::RemoveKeyAndSigner<Mpid>(const Mpid& key_to_be_removed) {
-  return RemovePassportKeyAndSigner(mpids_and_signers_, mutex_, key_to_be_removed);
+  std::lock_guard<std::mutex> lock{ mpids_mutex_ };
+  auto mpids_and_signers(std::atomic_load(&snapshot_)->mpids_and_signers_);
+  Mpid::Signer signer{ RemovePassportKeyAndSigner(mpids_and_signers, key_to_be_removed) };
+  Publish([&](Snapshot& snapshot) { snapshot.mpids_and_signers_ = mpids_and_signers; });
+  return signer;
 }
 
 Maid::Signer Passport::ReplaceMaidAndSigner(const Maid& maid_to_be_replaced,
                                             MaidAndSigner new_maid_and_signer) {
-  std::lock_guard<std::mutex> lock{ mutex_ };
-  if (!maid_and_signer_ || maid_and_signer_->first.name() != maid_to_be_replaced.name())
+  std::lock_guard<std::mutex> lock{ maid_mutex_ };
+  auto maid_and_signer(std::atomic_load(&snapshot_)->maid_and_signer_);
+  if (!maid_and_signer || maid_and_signer->first.name_ref() != maid_to_be_replaced.name_ref())
     BOOST_THROW_EXCEPTION(MakeError(CommonErrors::no_such_element));
-  if (new_maid_and_signer.first.name() == maid_and_signer_->first.name() ||
-      new_maid_and_signer.second.name() == maid_and_signer_->second.name()) {
+  if (new_maid_and_signer.first.name_ref() == maid_and_signer->first.name_ref() ||
+      new_maid_and_signer.second.name_ref() == maid_and_signer->second.name_ref()) {
     BOOST_THROW_EXCEPTION(MakeError(PassportErrors::id_already_exists));
   }
-  Maid::Signer signer{ std::move(maid_and_signer_->second) };
-  maid_and_signer_ = maidsafe::make_unique<MaidAndSigner>(new_maid_and_signer);
+  Maid::Signer signer{ maid_and_signer->second };
+  auto replacement(std::make_shared<const MaidAndSigner>(std::move(new_maid_and_signer)));
+  Publish([&](Snapshot& snapshot) { snapshot.maid_and_signer_ = replacement; });
   return signer;
 }
 
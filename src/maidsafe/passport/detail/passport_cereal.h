@@ -20,9 +20,12 @@
 #ifndef MAIDSAFE_PASSPORT_DETAIL_PASSPORT_CEREAL_H_
 #define MAIDSAFE_PASSPORT_DETAIL_PASSPORT_CEREAL_H_
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "maidsafe/passport/detail/byte_view.h"
+
 namespace maidsafe {
 
 namespace passport {
@@ -62,6 +65,62 @@ struct PassportCereal {
   std::vector<KeyAndSignerCereal> mpids_and_signers_;
 };
 
+// The fields of a serialised PassportCereal as views into the serialised bytes, which must outlive
+// the view.
+struct KeyAndSignerView {
+  ByteView key_;
+  ByteView signer_;
+};
+
+struct PassportView {
+  KeyAndSignerView maid_and_signer_;
+  std::vector<KeyAndSignerView> pmids_and_signers_;
+  std::vector<KeyAndSignerView> mpids_and_signers_;
+};
+
+// Reads the layout of PassportCereal from 'serialised_passport' without copying any fob.  Throws
+// parsing_error if the bytes are truncated.
+inline PassportView ParsePassportView(ByteView serialised_passport) {
+  ByteViewReader reader{ serialised_passport };
+  auto read_key_and_signer = [&reader]()->KeyAndSignerView {
+    KeyAndSignerView key_and_signer;
+    key_and_signer.key_ = reader.ReadString();
+    key_and_signer.signer_ = reader.ReadString();
+    return key_and_signer;
+  };
+  auto read_keys_and_signers = [&](std::vector<KeyAndSignerView>& keys_and_signers) {
+    keys_and_signers.resize(reader.ReadCount(2 * sizeof(cereal::size_type)));
+    for (auto& key_and_signer : keys_and_signers)
+      key_and_signer = read_key_and_signer();
+  };
+
+  PassportView view;
+  view.maid_and_signer_ = read_key_and_signer();
+  read_keys_and_signers(view.pmids_and_signers_);
+  read_keys_and_signers(view.mpids_and_signers_);
+  return view;
+}
+
+// Follows the envelope magic bytes in an envelope-format encrypted passport.  'wrapped_data_key_'
+// holds the random data key and IV encrypted under the credential-derived key, and 'body_' holds
+// the serialised PassportCereal encrypted under the data key.
+struct PassportEnvelopeCereal {
+  PassportEnvelopeCereal()
+    : version_ {},
+      wrapped_data_key_ {},
+      body_ {}
+  { }
+
+  template<typename Archive>
+  Archive& serialize(Archive& ref_archive) {
+    return ref_archive(version_, wrapped_data_key_, body_);
+  }
+
+  std::uint32_t version_;
+  std::string wrapped_data_key_;
+  std::string body_;
+};
+
 }  // namespace detail
 
 }  // namespace passport
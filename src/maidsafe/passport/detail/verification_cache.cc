@@ -0,0 +1,100 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/verification_cache.h"
+
+#include <utility>
+
+#include "maidsafe/common/crypto.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace detail {
+
+namespace {
+
+// Enough for the validation tokens of a large vault's worth of recently seen public fobs, at
+// roughly 200 bytes per entry.
+const std::size_t kDefaultCapacity(16384);
+
+}  // unnamed namespace
+
+VerificationCache& VerificationCache::Instance() {
+  static VerificationCache verification_cache(kDefaultCapacity);
+  return verification_cache;
+}
+
+VerificationCache::VerificationCache(std::size_t capacity)
+    : capacity_(capacity), entries_(), index_(), hits_(0), misses_(0), mutex_() {}
+
+bool VerificationCache::Verify(
+    std::initializer_list<std::reference_wrapper<const std::string>> inputs,
+    const std::function<bool()>& verify) {
+  std::string key;
+  for (const std::string& input : inputs)
+    key += std::to_string(input.size()) + ':' + input;
+  std::string digest(crypto::Hash<crypto::SHA512>(key).string());
+  {
+    std::lock_guard<std::mutex> lock{ mutex_ };
+    auto itr(index_.find(digest));
+    if (itr != std::end(index_)) {
+      ++hits_;
+      entries_.splice(std::begin(entries_), entries_, itr->second);
+      return itr->second->second;
+    }
+    ++misses_;
+  }
+
+  const bool result(verify());
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  if (capacity_ == 0 || index_.count(digest) != 0)
+    return result;
+  if (entries_.size() == capacity_) {
+    index_.erase(entries_.back().first);
+    entries_.pop_back();
+  }
+  entries_.emplace_front(digest, result);
+  index_.emplace(std::move(digest), std::begin(entries_));
+  return result;
+}
+
+VerificationCache::Statistics VerificationCache::GetStatistics() const {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  Statistics statistics;
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  statistics.entry_count = entries_.size();
+  const std::uint64_t lookups(hits_ + misses_);
+  statistics.hit_ratio =
+      lookups == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(lookups);
+  return statistics;
+}
+
+void VerificationCache::Clear() {
+  std::lock_guard<std::mutex> lock{ mutex_ };
+  entries_.clear();
+  index_.clear();
+}
+
+}  // namespace detail
+
+}  // namespace passport
+
+}  // namespace maidsafe
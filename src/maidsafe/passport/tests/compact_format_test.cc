@@ -0,0 +1,178 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/compact_format.h"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+namespace {
+
+template <typename FobType>
+void CheckFobFormats(const FobType& fob) {
+  const std::string v1(fob.Serialise(detail::WireFormat::kV1));
+  const std::string v2(fob.Serialise(detail::WireFormat::kV2));
+  EXPECT_EQ(fob.ToCereal(), v1);
+  EXPECT_FALSE(detail::IsCompactFormat(v1));
+  EXPECT_TRUE(detail::IsCompactFormat(v2));
+  EXPECT_LT(v2.size(), v1.size());
+
+  // Each format parses to the same fob, which re-serialises identically in either format.
+  const FobType from_v2(v2);
+  EXPECT_EQ(fob.name(), from_v2.name());
+  EXPECT_EQ(v1, from_v2.ToCereal());
+  EXPECT_EQ(v2, FobType(v1).Serialise(detail::WireFormat::kV2));
+  EXPECT_EQ(v2, FobType(v2, detail::ValidationMode::kDeferred).Serialise(detail::WireFormat::kV2));
+  EXPECT_EQ(fob.name()->string(), detail::ReadFobName(v1).string());
+  EXPECT_EQ(fob.name()->string(), detail::ReadFobName(v2).string());
+
+  // Truncated, extended or zero-length fields are rejected.
+  EXPECT_THROW(FobType(v2.substr(0, v2.size() - 1)), maidsafe_error);
+  EXPECT_THROW(FobType(v2 + 'x'), maidsafe_error);
+  EXPECT_THROW(FobType(v2.substr(0, detail::kCompactFobHeaderSize)), maidsafe_error);
+  EXPECT_THROW(detail::ReadFobName(v2.substr(0, v2.size() - 1)), maidsafe_error);
+  EXPECT_THROW(detail::ReadFobName(v1.substr(0, 12)), maidsafe_error);
+  std::string empty_field(v2);
+  empty_field[2] = empty_field[3] = 0;
+  EXPECT_THROW(FobType{ empty_field }, maidsafe_error);
+  std::string wrong_size(v2);
+  wrong_size[4] ^= 1;
+  EXPECT_THROW(FobType{ wrong_size }, maidsafe_error);
+
+  const detail::PublicFob<typename FobType::Tag> public_fob(fob);
+  const auto public_v1(public_fob.Serialise());
+  const auto public_v2(public_fob.Serialise(detail::WireFormat::kV2));
+  EXPECT_EQ(public_v1, public_fob.Serialise(detail::WireFormat::kV1));
+  EXPECT_TRUE(detail::IsCompactFormat(public_v2->string()));
+  EXPECT_LT(public_v2->string().size(), public_v1->string().size());
+  const detail::PublicFob<typename FobType::Tag> public_from_v2(public_fob.name(), public_v2);
+  EXPECT_EQ(public_v1, public_from_v2.Serialise());
+  EXPECT_TRUE(asymm::MatchingKeys(public_fob.public_key(), public_from_v2.public_key()));
+  const std::string public_serialised(public_v2->string());
+  EXPECT_THROW(detail::PublicFob<typename FobType::Tag>(
+                   public_fob.name(), detail::ByteView(public_serialised).substr(1)),
+               maidsafe_error);
+  EXPECT_THROW(detail::PublicFob<typename FobType::Tag>(
+                   public_fob.name(), public_serialised + 'x'), maidsafe_error);
+}
+
+template <typename FobType>
+void ReportFormatCosts(const std::string& type, const FobType& fob) {
+  const std::size_t kIterations(100);
+  const detail::PublicFob<typename FobType::Tag> public_fob(fob);
+  auto time([&](detail::WireFormat format, bool parse) {
+    const std::string serialised(fob.Serialise(format));
+    const auto public_serialised(public_fob.Serialise(format));
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t i(0); i != kIterations; ++i) {
+      if (parse) {
+        EXPECT_EQ(fob.name(), FobType(serialised).name());
+        EXPECT_EQ(public_fob.name(), detail::PublicFob<typename FobType::Tag>(
+                                         public_fob.name(), public_serialised).name());
+      } else {
+        EXPECT_EQ(serialised, fob.Serialise(format));
+        EXPECT_EQ(public_serialised, public_fob.Serialise(format));
+      }
+    }
+    return kIterations /
+           std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  const std::size_t v1_size(fob.Serialise(detail::WireFormat::kV1).size());
+  const std::size_t v2_size(fob.Serialise(detail::WireFormat::kV2).size());
+  const std::size_t public_v1_size(public_fob.Serialise()->string().size());
+  const std::size_t public_v2_size(
+      public_fob.Serialise(detail::WireFormat::kV2)->string().size());
+  LOG(kInfo) << type << ": fob " << v1_size << " -> " << v2_size << " bytes ("
+             << 100.0 * (v1_size - v2_size) / v1_size << "% smaller), public fob "
+             << public_v1_size << " -> " << public_v2_size << " bytes ("
+             << 100.0 * (public_v1_size - public_v2_size) / public_v1_size << "% smaller)";
+  LOG(kInfo) << type << ": fob and public fob pairs per second - serialise v1 "
+             << time(detail::WireFormat::kV1, false) << ", v2 "
+             << time(detail::WireFormat::kV2, false) << "; parse v1 "
+             << time(detail::WireFormat::kV1, true) << ", v2 "
+             << time(detail::WireFormat::kV2, true);
+}
+
+}  // unnamed namespace
+
+TEST(CompactFormatTest, BEH_RoundTripsAndRejects) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  Anmpid anmpid;
+  Mpid mpid(NonEmptyString(RandomAlphaNumericString(1 + RandomUint32() % 100)), anmpid);
+
+  CheckFobFormats(anmaid);
+  CheckFobFormats(maid);
+  CheckFobFormats(anpmid);
+  CheckFobFormats(pmid);
+  CheckFobFormats(anmpid);
+  CheckFobFormats(mpid);
+
+  // A fob or public fob of another type is rejected.
+  EXPECT_THROW(Anmaid{ maid.Serialise(detail::WireFormat::kV2) }, maidsafe_error);
+  EXPECT_THROW(Maid{ pmid.Serialise(detail::WireFormat::kV2) }, maidsafe_error);
+  EXPECT_THROW(PublicAnmaid(PublicAnmaid::Name(maid.name().value),
+                            PublicMaid(maid).Serialise(detail::WireFormat::kV2)->string()),
+               maidsafe_error);
+
+  // The Mpid's name is chosen rather than derived, so is carried and tamper-evident only through
+  // the signer chain; a v2 Mpid still round-trips it exactly.
+  std::string v2(mpid.Serialise(detail::WireFormat::kV2));
+  EXPECT_EQ(mpid.name()->string(), v2.substr(detail::kCompactFobHeaderSize, 64));
+  // Any other fob's name isn't sent.
+  EXPECT_EQ(std::string::npos, maid.Serialise(detail::WireFormat::kV2).find(maid.name()->string()));
+}
+
+TEST(CompactFormatTest, FUNC_SizeAndThroughput) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  Anmpid anmpid;
+  Mpid mpid(NonEmptyString(RandomAlphaNumericString(20)), anmpid);
+
+  ReportFormatCosts("Anmaid", anmaid);
+  ReportFormatCosts("Maid", maid);
+  ReportFormatCosts("Anpmid", anpmid);
+  ReportFormatCosts("Pmid", pmid);
+  ReportFormatCosts("Anmpid", anmpid);
+  ReportFormatCosts("Mpid", mpid);
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -0,0 +1,139 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/credential_session.h"
+
+#include <chrono>
+#include <string>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/make_unique.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/authentication/user_credential_utils.h"
+
+#include "maidsafe/passport/passport.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+namespace {
+
+authentication::UserCredentials CreateSessionCredentials() {
+  authentication::UserCredentials user_credentials;
+  user_credentials.keyword = maidsafe::make_unique<authentication::UserCredentials::Keyword>(
+      RandomAlphaNumericString((RandomUint32() % 100) + 1));
+  user_credentials.pin = maidsafe::make_unique<authentication::UserCredentials::Pin>(
+      std::to_string(RandomUint32()));
+  user_credentials.password = maidsafe::make_unique<authentication::UserCredentials::Password>(
+      RandomAlphaNumericString((RandomUint32() % 100) + 1));
+  return user_credentials;
+}
+
+}  // unnamed namespace
+
+TEST(CredentialSessionTest, BEH_InteroperatesWithUserCredentials) {
+  authentication::UserCredentials user_credentials{ CreateSessionCredentials() };
+  const CredentialSession session{ user_credentials };
+  MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  Passport passport{ maid_and_signer };
+  passport.AddKeyAndSigner(CreatePmidAndSigner());
+
+  // Either form of encryption can be decrypted by either form of decryption.
+  crypto::CipherText encrypted_with_session{ passport.Encrypt(session) };
+  crypto::CipherText encrypted_with_credentials{ passport.Encrypt(user_credentials) };
+  EXPECT_EQ(encrypted_with_credentials, encrypted_with_session);
+  Passport decrypted_with_session{ encrypted_with_credentials, session };
+  Passport decrypted_with_credentials{ encrypted_with_session, user_credentials };
+  EXPECT_EQ(maid_and_signer.first.name(), decrypted_with_session.GetMaid().name());
+  EXPECT_EQ(1U, decrypted_with_session.GetPmids().size());
+  EXPECT_EQ(maid_and_signer.first.name(), decrypted_with_credentials.GetMaid().name());
+
+  // The session keeps its own copy of the credentials.
+  user_credentials.password = maidsafe::make_unique<authentication::UserCredentials::Password>(
+      RandomAlphaNumericString(101));
+  EXPECT_NO_THROW(Passport(passport.Encrypt(session), session));
+  EXPECT_THROW(Passport(passport.Encrypt(session), user_credentials), maidsafe_error);
+
+  // A session for other credentials can't decrypt.
+  const CredentialSession other_session{ CreateSessionCredentials() };
+  EXPECT_THROW(Passport(encrypted_with_session, other_session), maidsafe_error);
+}
+
+TEST(CredentialSessionTest, BEH_DerivedMaterial) {
+  const authentication::UserCredentials user_credentials{ CreateSessionCredentials() };
+  const crypto::SecurePassword secure_password{
+      authentication::CreateSecurePassword(user_credentials) };
+  const crypto::AES256Key symm_key{ authentication::DeriveSymmEncryptKey(secure_password) };
+  const crypto::AES256InitialisationVector symm_iv{
+      authentication::DeriveSymmEncryptIv(secure_password) };
+
+  // Sessions' secrets may share pages; destroying one mustn't disturb another which outlives it.
+  auto first(maidsafe::make_unique<CredentialSession>(user_credentials));
+  const CredentialSession second{ user_credentials };
+  first.reset();
+  const crypto::AES256Key& key(second.symm_key());
+  EXPECT_EQ(symm_key, key);
+  EXPECT_EQ(symm_iv, second.symm_iv());
+  EXPECT_EQ(&key, &second.symm_key());
+}
+
+TEST(CredentialSessionTest, BEH_NullCredentialFields) {
+  authentication::UserCredentials user_credentials{ CreateSessionCredentials() };
+  user_credentials.keyword.reset();
+  EXPECT_THROW(CredentialSession{ user_credentials }, maidsafe_error);
+  user_credentials = CreateSessionCredentials();
+  user_credentials.pin.reset();
+  EXPECT_THROW(CredentialSession{ user_credentials }, maidsafe_error);
+  user_credentials = CreateSessionCredentials();
+  user_credentials.password.reset();
+  EXPECT_THROW(CredentialSession{ user_credentials }, maidsafe_error);
+}
+
+TEST(CredentialSessionTest, FUNC_RepeatedEncryption) {
+  const std::size_t kSaveCount(10);
+  authentication::UserCredentials user_credentials{ CreateSessionCredentials() };
+  Passport passport{ CreateMaidAndSigner() };
+
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t i(0); i != kSaveCount; ++i)
+    passport.Encrypt(user_credentials);
+  const double with_credentials(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  start = std::chrono::steady_clock::now();
+  const CredentialSession session{ user_credentials };
+  for (std::size_t i(0); i != kSaveCount; ++i)
+    passport.Encrypt(session);
+  const double with_session(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  LOG(kInfo) << kSaveCount << " saves: with credentials " << with_credentials
+             << "s, with session (including its creation) " << with_session << "s, speedup "
+             << with_credentials / with_session;
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
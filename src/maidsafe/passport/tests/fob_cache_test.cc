@@ -0,0 +1,147 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/fob_cache.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+TEST(FobCacheTest, BEH_FobHitsAndMisses) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  const std::string serialised_maid(maid.ToCereal());
+  detail::FobCache<Maid> cache(1024 * 1024);
+
+  auto first(cache.Parse(serialised_maid));
+  EXPECT_EQ(maid.name(), first->name());
+  auto second(cache.Parse(serialised_maid));
+  EXPECT_EQ(first, second);
+
+  auto statistics(cache.GetStatistics());
+  EXPECT_EQ(1U, statistics.hits);
+  EXPECT_EQ(1U, statistics.misses);
+  EXPECT_EQ(1U, statistics.entry_count);
+  EXPECT_GE(statistics.memory_usage, serialised_maid.size());
+
+  // Each validation mode has its own entry.
+  auto deferred(cache.Parse(serialised_maid, detail::ValidationMode::kDeferred));
+  EXPECT_NE(first, deferred);
+  EXPECT_FALSE(deferred->private_key_decoded());
+  EXPECT_EQ(deferred, cache.Parse(serialised_maid, detail::ValidationMode::kDeferred));
+  EXPECT_EQ(2U, cache.GetStatistics().entry_count);
+
+  // Invalid input throws and isn't cached.
+  const std::string anmaid_as_maid(anmaid.ToCereal());
+  EXPECT_THROW(cache.Parse(anmaid_as_maid), maidsafe_error);
+  EXPECT_THROW(cache.Parse(anmaid_as_maid), maidsafe_error);
+  statistics = cache.GetStatistics();
+  EXPECT_EQ(4U, statistics.misses);
+  EXPECT_EQ(2U, statistics.entry_count);
+
+  cache.Clear();
+  EXPECT_EQ(0U, cache.GetStatistics().entry_count);
+  EXPECT_EQ(0U, cache.GetStatistics().memory_usage);
+  EXPECT_NE(first, cache.Parse(serialised_maid));
+}
+
+TEST(FobCacheTest, BEH_PublicFobHitsAndMisses) {
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  PublicPmid public_pmid(pmid);
+  PublicPmid::serialised_type serialised(public_pmid.Serialise());
+  detail::FobCache<PublicPmid> cache(1024 * 1024);
+
+  auto first(cache.Parse(public_pmid.name(), serialised));
+  EXPECT_EQ(public_pmid.name(), first->name());
+  EXPECT_EQ(first, cache.Parse(public_pmid.name(), serialised));
+
+  // The same bytes under a different name are a different entry.
+  PublicPmid::Name other_name{ Identity{ RandomString(64) } };
+  auto renamed(cache.Parse(other_name, serialised));
+  EXPECT_NE(first, renamed);
+  EXPECT_EQ(other_name, renamed->name());
+
+  EXPECT_THROW(cache.Parse(PublicPmid::Name{}, serialised), maidsafe_error);
+  auto statistics(cache.GetStatistics());
+  EXPECT_EQ(1U, statistics.hits);
+  EXPECT_EQ(2U, statistics.misses);
+  EXPECT_EQ(2U, statistics.entry_count);
+}
+
+TEST(FobCacheTest, BEH_MemoryLimit) {
+  std::vector<std::string> serialised_anmaids;
+  for (int i(0); i != 4; ++i)
+    serialised_anmaids.emplace_back(Anmaid().ToCereal());
+
+  // Room for roughly two entries.
+  detail::FobCache<Anmaid> cache(5 * serialised_anmaids.front().size());
+  for (const auto& serialised_anmaid : serialised_anmaids)
+    cache.Parse(serialised_anmaid);
+  auto statistics(cache.GetStatistics());
+  EXPECT_EQ(2U, statistics.entry_count);
+  EXPECT_LE(statistics.memory_usage, 5 * serialised_anmaids.front().size());
+
+  // The most recently used entries are retained.
+  cache.Parse(serialised_anmaids[3]);
+  cache.Parse(serialised_anmaids[2]);
+  EXPECT_EQ(2U, cache.GetStatistics().hits);
+  cache.Parse(serialised_anmaids[0]);
+  EXPECT_EQ(2U, cache.GetStatistics().hits);
+
+  // Entries larger than the whole cache are parsed but not retained.
+  detail::FobCache<Anmaid> tiny_cache(16);
+  EXPECT_TRUE(tiny_cache.Parse(serialised_anmaids[0]) != nullptr);
+  EXPECT_EQ(0U, tiny_cache.GetStatistics().entry_count);
+}
+
+TEST(FobCacheTest, FUNC_ConcurrentParsing) {
+  std::vector<std::string> serialised_anpmids;
+  for (int i(0); i != 4; ++i)
+    serialised_anpmids.emplace_back(Anpmid().ToCereal());
+  detail::FobCache<Anpmid> cache(1024 * 1024);
+
+  std::vector<std::future<detail::FobCache<Anpmid>::FobPtr>> futures;
+  for (int i(0); i != 32; ++i) {
+    futures.emplace_back(std::async(std::launch::async,
+        [&, i] { return cache.Parse(serialised_anpmids[i % serialised_anpmids.size()]); }));
+  }
+  for (auto& future : futures)
+    EXPECT_TRUE(future.get() != nullptr);
+  auto statistics(cache.GetStatistics());
+  EXPECT_EQ(32U, statistics.hits + statistics.misses);
+  EXPECT_EQ(serialised_anpmids.size(), statistics.entry_count);
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
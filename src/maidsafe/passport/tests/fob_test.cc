@@ -18,7 +18,12 @@
 
 #include "maidsafe/passport/detail/fob.h"
 
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
 #include <string>
+#include <vector>
 
 #include "maidsafe/common/log.h"
 #include "maidsafe/common/rsa.h"
@@ -27,7 +32,10 @@
 
 #include "maidsafe/common/serialisation/serialisation.h"
 
+#include "maidsafe/passport/passport.h"
 #include "maidsafe/passport/types.h"
+#include "maidsafe/passport/detail/public_fob.h"
+#include "maidsafe/passport/tests/allocation_counter.h"
 
 namespace maidsafe {
 
@@ -159,6 +167,105 @@ bool CheckNamingAndValidation(Fobtype fob, asymm::PublicKey signer_public_key,
                            Identity(fob.name()), chosen_name);
 }
 
+TEST(FobTest, BEH_ParseFromView) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  Anmpid anmpid;
+  Mpid mpid(NonEmptyString(RandomAlphaNumericString(1 + RandomUint32() % 100)), anmpid);
+  PublicMaid public_maid(maid);
+
+  // Parse each from the middle of a larger buffer, as a receive buffer would hold it.
+  const std::string serialised_maid(maid.ToCereal()), serialised_mpid(mpid.ToCereal());
+  const std::string serialised_public_maid(public_maid.Serialise()->string());
+  const std::string padding(RandomString(7));
+  const std::string buffer(padding + serialised_maid + serialised_mpid + serialised_public_maid +
+                           padding);
+  const detail::ByteView view(buffer);
+  const detail::ByteView maid_view(view.substr(padding.size(), serialised_maid.size()));
+  const detail::ByteView mpid_view(
+      view.substr(padding.size() + serialised_maid.size(), serialised_mpid.size()));
+  const detail::ByteView public_maid_view(view.substr(
+      padding.size() + serialised_maid.size() + serialised_mpid.size(),
+      serialised_public_maid.size()));
+
+  const Maid maid_from_view(maid_view);
+  EXPECT_EQ(serialised_maid, maid_from_view.ToCereal());
+  EXPECT_EQ(Maid(serialised_maid).ToCereal(), maid_from_view.ToCereal());
+  EXPECT_TRUE(CheckSerialisationAndParsing(maid_from_view));
+  const Mpid mpid_from_view(mpid_view);
+  EXPECT_EQ(serialised_mpid, mpid_from_view.ToCereal());
+  EXPECT_EQ(mpid.name(), mpid_from_view.name());
+  const PublicMaid public_maid_from_view(public_maid.name(), public_maid_view);
+  EXPECT_EQ(serialised_public_maid, public_maid_from_view.Serialise()->string());
+  EXPECT_TRUE(asymm::MatchingKeys(public_maid.public_key(), public_maid_from_view.public_key()));
+
+  // Truncated, empty and garbage views are rejected just as the equivalent strings are.
+  EXPECT_THROW(Maid{ maid_view.substr(0, maid_view.size() / 2) }, maidsafe_error);
+  EXPECT_THROW(Maid{ detail::ByteView() }, maidsafe_error);
+  EXPECT_THROW(Maid{ detail::ByteView(padding) }, maidsafe_error);
+  EXPECT_THROW(Mpid{ mpid_view.substr(0, mpid_view.size() - 1) }, maidsafe_error);
+  EXPECT_THROW(PublicMaid(public_maid.name(), public_maid_view.substr(0, 1)), maidsafe_error);
+  EXPECT_THROW(PublicMaid(public_maid.name(), detail::ByteView()), maidsafe_error);
+  EXPECT_THROW(PublicMaid(PublicMaid::Name(), public_maid_view), maidsafe_error);
+}
+
+TEST(FobTest, BEH_ReadListsInPlace) {
+  const auto test_path(maidsafe::test::CreateTestPath("MaidSafe_TestFob"));
+  std::vector<Pmid> pmids;
+  std::vector<detail::AnmaidToPmid> keychains;
+  for (int i(0); i != 3; ++i) {
+    Anmaid anmaid;
+    Maid maid(anmaid);
+    Anpmid anpmid;
+    Pmid pmid(anpmid);
+    pmids.push_back(pmid);
+    keychains.emplace_back(anmaid, maid, anpmid, pmid);
+  }
+
+  ASSERT_TRUE(detail::WritePmidList(*test_path / "pmids", pmids));
+  const std::vector<Pmid> read_pmids(detail::ReadPmidList(*test_path / "pmids"));
+  ASSERT_EQ(pmids.size(), read_pmids.size());
+  for (std::size_t i(0); i != pmids.size(); ++i)
+    EXPECT_EQ(pmids[i].ToCereal(), read_pmids[i].ToCereal());
+
+  ASSERT_TRUE(detail::WriteKeyChainList(*test_path / "keychains", keychains));
+  const std::vector<detail::AnmaidToPmid> read_keychains(
+      detail::ReadKeyChainList(*test_path / "keychains"));
+  ASSERT_EQ(keychains.size(), read_keychains.size());
+  for (std::size_t i(0); i != keychains.size(); ++i) {
+    EXPECT_EQ(keychains[i].anmaid.ToCereal(), read_keychains[i].anmaid.ToCereal());
+    EXPECT_EQ(keychains[i].maid.ToCereal(), read_keychains[i].maid.ToCereal());
+    EXPECT_EQ(keychains[i].anpmid.ToCereal(), read_keychains[i].anpmid.ToCereal());
+    EXPECT_EQ(keychains[i].pmid.ToCereal(), read_keychains[i].pmid.ToCereal());
+  }
+
+  // A truncated list is rejected when an entry runs past the end of the file.
+  const std::string serialised(ReadFile(*test_path / "keychains").string());
+  ASSERT_TRUE(WriteFile(*test_path / "truncated", serialised.substr(0, serialised.size() / 2)));
+  EXPECT_THROW(detail::ReadKeyChainList(*test_path / "truncated"), maidsafe_error);
+
+  // A count claiming more entries than the file could hold is rejected before anything is reserved
+  // for them; unchecked, this count would make reserve() throw std::length_error or bad_alloc.
+  for (const std::string& list : { std::string("pmids"), std::string("keychains") }) {
+    std::string corrupted(ReadFile(*test_path / list).string());
+    const cereal::size_type huge_count(cereal::size_type(1) << 60);
+    std::memcpy(&corrupted[0], &huge_count, sizeof(huge_count));
+    ASSERT_TRUE(WriteFile(*test_path / "corrupted", corrupted));
+    if (list == "pmids")
+      EXPECT_THROW(detail::ReadPmidList(*test_path / "corrupted"), maidsafe_error);
+    else
+      EXPECT_THROW(detail::ReadKeyChainList(*test_path / "corrupted"), maidsafe_error);
+  }
+
+  // The bound is exact: each element must have 'min_element_size' bytes remaining.
+  std::string counted(sizeof(cereal::size_type) + 15, '\0');
+  const cereal::size_type two(2), one(1);
+  std::memcpy(&counted[0], &two, sizeof(two));
+  EXPECT_THROW(detail::ByteViewReader{ detail::ByteView(counted) }.ReadCount(8), maidsafe_error);
+  std::memcpy(&counted[0], &one, sizeof(one));
+  EXPECT_EQ(1U, detail::ByteViewReader{ detail::ByteView(counted) }.ReadCount(8));
+}
+
 TEST(FobTest, BEH_NamingAndValidation) {
   Anmaid anmaid;
   Maid maid(anmaid);
@@ -176,6 +283,371 @@ TEST(FobTest, BEH_NamingAndValidation) {
   EXPECT_TRUE(CheckNamingAndValidation(mpid, anmpid.public_key(), chosen_name));
 }
 
+TEST(FobTest, BEH_MismatchedKeysRejected) {
+  Anpmid anpmid, other_anpmid;
+  Pmid pmid(anpmid), other_pmid(other_anpmid);
+  asymm::Keys keys;
+  keys.private_key = pmid.private_key();
+  keys.public_key = pmid.public_key();
+  EXPECT_TRUE(detail::KeysMatch(keys));
+  keys.private_key = other_pmid.private_key();
+  EXPECT_FALSE(detail::KeysMatch(keys));
+
+  // Splice another fob's private key into an otherwise valid serialised Pmid.
+  detail::FobCereal fob_cereal;
+  maidsafe::ConvertFromString(pmid.ToCereal(), fob_cereal);
+  fob_cereal.private_key_ = asymm::EncodeKey(other_pmid.private_key());
+  const std::string spliced(maidsafe::ConvertToString(fob_cereal));
+
+  EXPECT_THROW(Pmid(spliced, detail::ValidationMode::kKeyConsistency), maidsafe_error);
+  EXPECT_THROW(Pmid(spliced, detail::ValidationMode::kRoundTrip), maidsafe_error);
+  EXPECT_NO_THROW(Pmid(pmid.ToCereal(), detail::ValidationMode::kKeyConsistency));
+  EXPECT_NO_THROW(Pmid(pmid.ToCereal(), detail::ValidationMode::kRoundTrip));
+}
+
+TEST(FobTest, BEH_StagedValidationRejects) {
+  Anpmid anpmid, other_anpmid;
+  Pmid pmid(anpmid), other_pmid(other_anpmid);
+  const std::string serialised_pmid(pmid.ToCereal());
+
+  auto rejected_at([&](std::function<void(detail::FobCereal&)> corrupt)
+                       -> detail::ValidationStatistics {
+    detail::FobCereal fob_cereal;
+    maidsafe::ConvertFromString(serialised_pmid, fob_cereal);
+    corrupt(fob_cereal);
+    const std::string corrupted(maidsafe::ConvertToString(fob_cereal));
+    const detail::ValidationStatistics before(detail::GetValidationStatistics());
+    EXPECT_THROW(Pmid{ corrupted }, maidsafe_error);
+    const detail::ValidationStatistics after(detail::GetValidationStatistics());
+    detail::ValidationStatistics difference;
+    difference.accepted = after.accepted - before.accepted;
+    difference.tag_rejects = after.tag_rejects - before.tag_rejects;
+    difference.encoding_rejects = after.encoding_rejects - before.encoding_rejects;
+    difference.name_rejects = after.name_rejects - before.name_rejects;
+    difference.key_rejects = after.key_rejects - before.key_rejects;
+    difference.round_trips = after.round_trips - before.round_trips;
+    return difference;
+  });
+
+  // Counters are process-wide, so other threads may only ever add to them.
+  auto tag(rejected_at([](detail::FobCereal& fob_cereal) {
+    fob_cereal.type_ = static_cast<std::uint32_t>(detail::AnpmidTag::kValue);
+  }));
+  EXPECT_GE(tag.tag_rejects, 1U);
+
+  auto encoding(rejected_at([](detail::FobCereal& fob_cereal) {
+    fob_cereal.validation_token_ = asymm::Signature{ RandomString(4096) };
+  }));
+  EXPECT_GE(encoding.encoding_rejects, 1U);
+
+  auto name(rejected_at([](detail::FobCereal& fob_cereal) {
+    fob_cereal.name_ = Identity{ RandomString(64) };
+  }));
+  EXPECT_GE(name.name_rejects, 1U);
+
+  // An undecodable public key with a matching name gets past the name stage.
+  auto undecodable(rejected_at([](detail::FobCereal& fob_cereal) {
+    fob_cereal.public_key_ = asymm::EncodedPublicKey{ RandomString(100) };
+    fob_cereal.name_ = detail::CreateFobName(fob_cereal.public_key_,
+                                             fob_cereal.validation_token_);
+  }));
+  EXPECT_GE(undecodable.encoding_rejects, 1U);
+
+  // As does a decodable but non-canonical public key, which is rejected once decoded.
+  auto non_canonical(rejected_at([](detail::FobCereal& fob_cereal) {
+    fob_cereal.public_key_ = asymm::EncodedPublicKey{ fob_cereal.public_key_.string() + '\0' };
+    fob_cereal.name_ = detail::CreateFobName(fob_cereal.public_key_,
+                                             fob_cereal.validation_token_);
+  }));
+  EXPECT_GE(non_canonical.encoding_rejects, 1U);
+
+  auto keys(rejected_at([&](detail::FobCereal& fob_cereal) {
+    fob_cereal.private_key_ = asymm::EncodeKey(other_pmid.private_key());
+  }));
+  EXPECT_GE(keys.key_rejects, 1U);
+
+  const auto accepted_before(detail::GetValidationStatistics().accepted);
+  EXPECT_NO_THROW(Pmid{ serialised_pmid });
+  EXPECT_GE(detail::GetValidationStatistics().accepted, accepted_before + 1);
+}
+
+TEST(FobTest, FUNC_ValidationModeThroughput) {
+  // Passport::Parse reconstructs a Pmid and an Anpmid per entry; time that work in each mode.
+  const std::size_t kEntryCount(32);
+  std::vector<PmidAndSigner> pmids_and_signers{ CreatePmidAndSignerBatch(kEntryCount) };
+  std::vector<std::pair<std::string, std::string>> serialised;
+  for (const auto& pmid_and_signer : pmids_and_signers) {
+    serialised.emplace_back(pmid_and_signer.first.ToCereal(),
+                            pmid_and_signer.second.ToCereal());
+  }
+
+  auto time_parsing([&](detail::ValidationMode mode) {
+    auto start(std::chrono::steady_clock::now());
+    for (const auto& entry : serialised) {
+      Pmid pmid(entry.first, mode);
+      Anpmid anpmid(entry.second, mode);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  const double round_trip(time_parsing(detail::ValidationMode::kRoundTrip));
+  const double key_consistency(time_parsing(detail::ValidationMode::kKeyConsistency));
+  LOG(kInfo) << "Parsing " << kEntryCount << " Pmid entries: round trip " << round_trip
+             << "s, key consistency " << key_consistency << "s, speedup "
+             << round_trip / key_consistency;
+}
+
+TEST(FobTest, BEH_DeferredPrivateKey) {
+  Anpmid anpmid, other_anpmid;
+  Pmid pmid(anpmid), other_pmid(other_anpmid);
+  EXPECT_TRUE(pmid.private_key_decoded());
+
+  // Nothing needing the private key decodes it.
+  const Pmid deferred(pmid.ToCereal(), detail::ValidationMode::kDeferred);
+  EXPECT_FALSE(deferred.private_key_decoded());
+  EXPECT_EQ(pmid.name(), deferred.name());
+  EXPECT_TRUE(asymm::MatchingKeys(pmid.public_key(), deferred.public_key()));
+  EXPECT_EQ(pmid.ToCereal(), deferred.ToCereal());
+  const Pmid undecoded_copy(deferred);
+  EXPECT_FALSE(deferred.private_key_decoded());
+
+  // Concurrent first uses all see the same decoded key, which later copies share.
+  std::vector<std::future<const asymm::PrivateKey*>> first_uses;
+  for (int i(0); i != 4; ++i) {
+    first_uses.push_back(std::async(std::launch::async,
+                                    [&] { return &deferred.private_key_ref(); }));
+  }
+  const asymm::PrivateKey* const decoded(&deferred.private_key_ref());
+  for (auto& first_use : first_uses)
+    EXPECT_EQ(decoded, first_use.get());
+  EXPECT_TRUE(deferred.private_key_decoded());
+  EXPECT_TRUE(asymm::MatchingKeys(pmid.private_key(), deferred.private_key()));
+  EXPECT_FALSE(undecoded_copy.private_key_decoded());
+  const Pmid decoded_copy(deferred);
+  EXPECT_EQ(decoded, &decoded_copy.private_key_ref());
+
+  // A mismatched private key is only reported when it's used, and on every use.
+  detail::FobCereal fob_cereal;
+  maidsafe::ConvertFromString(pmid.ToCereal(), fob_cereal);
+  fob_cereal.private_key_ = asymm::EncodeKey(other_pmid.private_key());
+  const std::string spliced(maidsafe::ConvertToString(fob_cereal));
+  EXPECT_THROW(Pmid(spliced, detail::ValidationMode::kKeyConsistency), maidsafe_error);
+  const Pmid invalid(spliced, detail::ValidationMode::kDeferred);
+  EXPECT_EQ(spliced, invalid.ToCereal());
+  EXPECT_THROW(invalid.private_key_ref(), maidsafe_error);
+  EXPECT_THROW(invalid.private_key(), maidsafe_error);
+  EXPECT_FALSE(invalid.private_key_decoded());
+}
+
+TEST(FobTest, FUNC_DeferredPrivateKeyCost) {
+  // Passport::Parse reconstructs a Pmid and an Anpmid per entry, deferring the Anpmid's private
+  // key if asked to; compare the time and the retained private key size of doing so eagerly and
+  // deferred.
+  const std::size_t kEntryCount(32);
+  std::vector<PmidAndSigner> pmids_and_signers{ CreatePmidAndSignerBatch(kEntryCount) };
+  std::vector<std::pair<std::string, std::string>> serialised;
+  for (const auto& pmid_and_signer : pmids_and_signers) {
+    serialised.emplace_back(pmid_and_signer.first.ToCereal(),
+                            pmid_and_signer.second.ToCereal());
+  }
+
+  auto time_parsing([&](detail::ValidationMode mode) {
+    auto start(std::chrono::steady_clock::now());
+    for (const auto& entry : serialised) {
+      Pmid pmid(entry.first, mode);
+      Anpmid anpmid(entry.second, mode);
+      EXPECT_EQ(mode != detail::ValidationMode::kDeferred, pmid.private_key_decoded());
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  const double eager(time_parsing(detail::ValidationMode::kKeyConsistency));
+  const double deferred(time_parsing(detail::ValidationMode::kDeferred));
+
+  // The decoded key's size is taken as that of its multi-precision components, which dominate it.
+  std::size_t encoded_size(0), decoded_size(0);
+  for (const auto& pmid_and_signer : pmids_and_signers) {
+    const asymm::PrivateKey& private_key(pmid_and_signer.first.private_key_ref());
+    encoded_size += asymm::EncodeKey(private_key).string().size();
+    decoded_size += private_key.GetModulus().ByteCount() +
+                    private_key.GetPublicExponent().ByteCount() +
+                    private_key.GetPrivateExponent().ByteCount() +
+                    private_key.GetPrime1().ByteCount() + private_key.GetPrime2().ByteCount() +
+                    private_key.GetModPrime1PrivateExponent().ByteCount() +
+                    private_key.GetModPrime2PrivateExponent().ByteCount() +
+                    private_key.GetMultiplicativeInverseOfPrime2ModPrime1().ByteCount();
+  }
+
+  LOG(kInfo) << "Parsing " << kEntryCount << " Pmid entries: eager " << eager << "s, deferred "
+             << deferred << "s, speedup " << eager / deferred << ".  Per Pmid private key: "
+             << encoded_size / kEntryCount << " bytes encoded (always held), "
+             << decoded_size / kEntryCount << " bytes decoded (eager only)";
+}
+
+TEST(FobTest, BEH_SignAndSignBatch) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  std::vector<asymm::PlainText> messages;
+  for (int i(0); i != 10; ++i)
+    messages.emplace_back(RandomString(1 + RandomUint32() % 1000));
+
+  const asymm::Signature signature(maid.Sign(messages[0]));
+  EXPECT_TRUE(asymm::CheckSignature(messages[0], signature, maid.public_key()));
+  EXPECT_FALSE(asymm::CheckSignature(messages[1], signature, maid.public_key()));
+
+  for (unsigned thread_count : { 0U, 1U, 3U }) {
+    const std::vector<asymm::Signature> signatures(maid.SignBatch(messages, thread_count));
+    ASSERT_EQ(messages.size(), signatures.size());
+    for (std::size_t i(0); i != messages.size(); ++i)
+      EXPECT_TRUE(asymm::CheckSignature(messages[i], signatures[i], maid.public_key()));
+  }
+  EXPECT_TRUE(maid.SignBatch(std::vector<asymm::PlainText>()).empty());
+
+  // A deferred private key is decoded by the first signing, and an invalid one throws.
+  const Maid deferred(maid.ToCereal(), detail::ValidationMode::kDeferred);
+  EXPECT_TRUE(asymm::CheckSignature(messages[0], deferred.Sign(messages[0]), maid.public_key()));
+  EXPECT_TRUE(deferred.private_key_decoded());
+  detail::FobCereal fob_cereal;
+  maidsafe::ConvertFromString(maid.ToCereal(), fob_cereal);
+  fob_cereal.private_key_ = asymm::EncodeKey(Anmaid().private_key());
+  const Maid invalid(maidsafe::ConvertToString(fob_cereal), detail::ValidationMode::kDeferred);
+  EXPECT_THROW(invalid.Sign(messages[0]), maidsafe_error);
+  EXPECT_THROW(invalid.SignBatch(messages), maidsafe_error);
+}
+
+TEST(FobTest, FUNC_SigningThroughput) {
+  // Mirrors signing Maid-based put and delete requests, comparing copying the private key per
+  // message, as callers did before Sign existed, with Sign and SignBatch.
+  const std::size_t kMessageCount(1000);
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  std::vector<asymm::PlainText> messages;
+  for (std::size_t i(0); i != kMessageCount; ++i)
+    messages.emplace_back(RandomString(256));
+
+  auto time_signing([&](const std::function<void()>& sign) {
+    auto start(std::chrono::steady_clock::now());
+    sign();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  const double copying(time_signing([&] {
+    for (const auto& message : messages)
+      asymm::Sign(message, maid.private_key());
+  }));
+  const double sign(time_signing([&] {
+    for (const auto& message : messages)
+      maid.Sign(message);
+  }));
+  const double sign_batch(time_signing([&] { maid.SignBatch(messages); }));
+
+  LOG(kInfo) << "Signing " << kMessageCount << " messages: copying the key " << copying
+             << "s, Sign " << sign << "s, SignBatch " << sign_batch << "s ("
+             << kMessageCount / sign_batch << " signatures per second)";
+}
+
+TEST(FobTest, FUNC_SerialisationCost) {
+  // Compare serialising with the cached encodings against re-encoding both keys on every call, as
+  // was done before the encodings were retained.
+  const std::size_t kIterations(1000);
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  EXPECT_EQ(maid.ToCereal(), maid.ToCereal());
+  EXPECT_EQ(asymm::EncodeKey(maid.public_key()), maid.encoded_public_key());
+
+  auto time_serialising([&](const std::function<std::string()>& serialise) {
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t i(0); i != kIterations; ++i)
+      EXPECT_FALSE(serialise().empty());
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  });
+
+  const double reencoding(time_serialising([&] {
+    detail::FobCereal fob_cereal;
+    fob_cereal.type_ = static_cast<std::uint32_t>(Maid::Tag::kValue);
+    fob_cereal.name_ = maid.name().value;
+    fob_cereal.private_key_ = asymm::EncodeKey(maid.private_key());
+    fob_cereal.public_key_ = asymm::EncodeKey(maid.public_key());
+    fob_cereal.validation_token_ = maid.validation_token();
+    return ConvertToString(fob_cereal);
+  }));
+  const double cached(time_serialising([&] { return maid.ToCereal(); }));
+  LOG(kInfo) << "Per-ToCereal cost: re-encoding " << reencoding / kIterations * 1e6
+             << "us, cached encodings " << cached / kIterations * 1e6 << "us, speedup "
+             << reencoding / cached;
+}
+
+TEST(FobTest, FUNC_ViewParsingAllocations) {
+  // Mirrors parsing fobs out of a larger received buffer: copy each into its own string first, as
+  // was done before the view constructors, against parsing from a view of the buffer.
+  const std::size_t kIterations(1000);
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  const std::string serialised(maid.ToCereal());
+  const std::string buffer(RandomString(64) + serialised);
+  const detail::ByteView view(detail::ByteView(buffer).substr(64));
+
+  auto count_parsing([&](const std::function<Maid()>& parse) {
+    const std::size_t before(AllocationCount());
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t i(0); i != kIterations; ++i)
+      EXPECT_EQ(maid.name(), parse().name());
+    const double time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return std::make_pair(AllocationCount() - before, time);
+  });
+
+  const auto copying(count_parsing([&] { return Maid(buffer.substr(64)); }));
+  const auto in_place(count_parsing([&] { return Maid(view); }));
+  EXPECT_LT(in_place.first, copying.first);
+  LOG(kInfo) << kIterations << " parses: copying " << copying.first << " allocations in "
+             << copying.second << "s, in place " << in_place.first << " allocations in "
+             << in_place.second << "s";
+}
+
+TEST(FobTest, FUNC_AccessorAllocations) {
+  // Mirrors the per-message signing path: read the name, keys and token of a fob and its public
+  // counterpart.  The reference accessors must not allocate at all on this thread.
+  const std::size_t kIterations(1000);
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  PublicMaid public_maid(maid);
+
+  std::size_t sink(0);
+  std::size_t before(AllocationCount());
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t i(0); i != kIterations; ++i) {
+    sink += maid.name()->string().size() + maid.validation_token().string().size();
+    asymm::PrivateKey private_key(maid.private_key());
+    asymm::PublicKey public_key(public_maid.public_key());
+    sink += public_maid.name()->string().size();
+  }
+  const double by_value_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const std::size_t by_value_allocations(AllocationCount() - before);
+
+  before = AllocationCount();
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i(0); i != kIterations; ++i) {
+    sink += maid.name_ref()->string().size() + maid.validation_token_ref().string().size();
+    const asymm::PrivateKey& private_key(maid.private_key_ref());
+    const asymm::PublicKey& public_key(public_maid.public_key_ref());
+    static_cast<void>(private_key);
+    static_cast<void>(public_key);
+    sink += public_maid.name_ref()->string().size();
+  }
+  const double by_reference_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const std::size_t by_reference_allocations(AllocationCount() - before);
+
+  EXPECT_NE(0U, sink);
+  EXPECT_EQ(0U, by_reference_allocations);
+  EXPECT_LT(by_reference_allocations, by_value_allocations);
+  LOG(kInfo) << kIterations << " accessor rounds: by value " << by_value_allocations
+             << " allocations in " << by_value_time << "s, by reference "
+             << by_reference_allocations << " allocations in " << by_reference_time << "s";
+}
+
 }  // namespace test
 
 }  // namespace passport
@@ -0,0 +1,118 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/key_pool.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+namespace {
+
+bool WaitForSize(const detail::KeyPool& key_pool, std::size_t size) {
+  auto deadline(std::chrono::steady_clock::now() + std::chrono::minutes(1));
+  while (key_pool.Size() < size) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+bool ValidKeys(const asymm::Keys& keys) {
+  asymm::PlainText plain{ RandomString(64) };
+  return asymm::CheckSignature(plain, asymm::Sign(plain, keys.private_key), keys.public_key);
+}
+
+}  // unnamed namespace
+
+TEST(KeyPoolTest, BEH_InvalidConfig) {
+  EXPECT_THROW(detail::KeyPool(detail::KeyPool::Config(3, 2, 1)), maidsafe_error);
+  detail::KeyPool key_pool{ detail::KeyPool::Config(0, 0, 0) };
+  EXPECT_THROW(key_pool.Configure(detail::KeyPool::Config(3, 2, 1)), maidsafe_error);
+}
+
+TEST(KeyPoolTest, BEH_DisabledPoolGeneratesOnDemand) {
+  detail::KeyPool key_pool{ detail::KeyPool::Config(0, 0, 0) };
+  for (int i(0); i != 3; ++i)
+    EXPECT_TRUE(ValidKeys(key_pool.Get()));
+  EXPECT_EQ(0U, key_pool.Size());
+  EXPECT_EQ(0U, key_pool.GetStatistics().served_from_pool);
+  EXPECT_EQ(3U, key_pool.GetStatistics().generated_on_demand);
+}
+
+TEST(KeyPoolTest, FUNC_RefillsToWatermarks) {
+  const std::size_t kLowWatermark(2), kHighWatermark(4);
+  detail::KeyPool key_pool{ detail::KeyPool::Config(kLowWatermark, kHighWatermark, 2) };
+
+  // Workers are only started by the first request.
+  EXPECT_TRUE(ValidKeys(key_pool.Get()));
+  ASSERT_TRUE(WaitForSize(key_pool, kLowWatermark));
+  EXPECT_LE(key_pool.Size(), kHighWatermark);
+
+  // Draining the pool should be served from it, and it should refill afterwards.
+  const auto served_before(key_pool.GetStatistics().served_from_pool);
+  for (std::size_t i(0); i != kLowWatermark; ++i)
+    EXPECT_TRUE(ValidKeys(key_pool.Get()));
+  EXPECT_EQ(served_before + kLowWatermark, key_pool.GetStatistics().served_from_pool);
+  ASSERT_TRUE(WaitForSize(key_pool, kLowWatermark));
+  EXPECT_LE(key_pool.Size(), kHighWatermark);
+
+  // Reconfiguring trims surplus pairs and disabling workers stops refills.
+  key_pool.Configure(detail::KeyPool::Config(0, 1, 0));
+  EXPECT_LE(key_pool.Size(), 1U);
+  EXPECT_TRUE(ValidKeys(key_pool.Get()));
+  EXPECT_TRUE(ValidKeys(key_pool.Get()));
+  EXPECT_EQ(0U, key_pool.Size());
+}
+
+TEST(KeyPoolTest, FUNC_ParallelGets) {
+  detail::KeyPool key_pool{ detail::KeyPool::Config(1, 8, 1) };
+  std::vector<std::future<asymm::Keys>> futures;
+  for (int i(0); i != 8; ++i)
+    futures.emplace_back(std::async(std::launch::async, [&] { return key_pool.Get(); }));
+  std::vector<asymm::Keys> all_keys;
+  for (auto& future : futures) {
+    all_keys.emplace_back(future.get());
+    EXPECT_TRUE(ValidKeys(all_keys.back()));
+  }
+  for (std::size_t i(0); i != all_keys.size(); ++i) {
+    for (std::size_t j(i + 1); j != all_keys.size(); ++j)
+      EXPECT_FALSE(asymm::MatchingKeys(all_keys[i].public_key, all_keys[j].public_key));
+  }
+  const auto statistics(key_pool.GetStatistics());
+  EXPECT_EQ(8U, statistics.served_from_pool + statistics.generated_on_demand);
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -0,0 +1,305 @@
+/*  Copyright 2012 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/keys_and_signers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+namespace {
+
+// Minimal stand-ins for fobs, so that the container can be exercised at sizes where generating
+// real key pairs would dominate the measurement.
+struct FakeName {
+  explicit FakeName(std::string name_in) : name(std::move(name_in)) {}
+  const FakeName* operator->() const { return this; }
+  const std::string& string() const { return name; }
+  std::string name;
+};
+
+struct FakeSigner {
+  typedef FakeName Name;
+  explicit FakeSigner(std::string name) : name_(std::move(name)) {}
+  FakeSigner(std::string name, detail::ValidationMode) : name_(std::move(name)) {}
+  const Name& name_ref() const { return name_; }
+  Name name_;
+};
+
+struct FakeKey {
+  typedef FakeName Name;
+  typedef FakeSigner Signer;
+  explicit FakeKey(std::string name) : name_(std::move(name)) {}
+  FakeKey(std::string name, detail::ValidationMode) : name_(std::move(name)) {}
+  const Name& name_ref() const { return name_; }
+  Name name_;
+};
+
+typedef detail::KeysAndSigners<FakeKey> FakeKeysAndSigners;
+
+std::vector<std::string> RandomNames(std::size_t count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (std::size_t i(0); i != count; ++i)
+    names.push_back(RandomString(64));
+  return names;
+}
+
+}  // unnamed namespace
+
+TEST(KeysAndSignersTest, BEH_AddFindAndRemove) {
+  const std::vector<std::string> key_names(RandomNames(10)), signer_names(RandomNames(10));
+  FakeKeysAndSigners keys_and_signers;
+  EXPECT_TRUE(keys_and_signers.empty());
+  for (std::size_t i(0); i != key_names.size(); ++i) {
+    EXPECT_TRUE(keys_and_signers.Add(
+        std::make_pair(FakeKey{ key_names[i] }, FakeSigner{ signer_names[i] })));
+  }
+  EXPECT_EQ(key_names.size(), keys_and_signers.size());
+
+  // Duplicate key name or duplicate signer name is rejected, leaving the argument intact.
+  auto duplicate_key(std::make_pair(FakeKey{ key_names[3] }, FakeSigner{ RandomString(64) }));
+  EXPECT_FALSE(keys_and_signers.Add(std::move(duplicate_key)));
+  EXPECT_EQ(key_names[3], duplicate_key.first.name_.name);
+  EXPECT_FALSE(keys_and_signers.Add(
+      std::make_pair(FakeKey{ RandomString(64) }, FakeSigner{ signer_names[7] })));
+  EXPECT_EQ(key_names.size(), keys_and_signers.size());
+
+  // Lookup.
+  auto found(keys_and_signers.Find(FakeName{ key_names[5] }));
+  ASSERT_NE(std::end(keys_and_signers), found);
+  EXPECT_EQ(signer_names[5], found->Get().second.name_.name);
+  EXPECT_EQ(std::end(keys_and_signers), keys_and_signers.Find(FakeName{ RandomString(64) }));
+
+  // Copies share the stored entries but are otherwise independent.
+  const FakeKeysAndSigners copy(keys_and_signers);
+  EXPECT_EQ(&*found, &*copy.Find(FakeName{ key_names[5] }));
+
+  // Removal frees both names for reuse and preserves the order of the remainder.
+  auto removed(found->Get());
+  keys_and_signers.Remove(found);
+  EXPECT_EQ(std::end(keys_and_signers), keys_and_signers.Find(FakeName{ key_names[5] }));
+  EXPECT_EQ(key_names.size(), copy.size());
+  EXPECT_NE(std::end(copy), copy.Find(FakeName{ key_names[5] }));
+  EXPECT_TRUE(keys_and_signers.Add(std::move(removed)));
+
+  std::vector<std::string> expected_order(key_names);
+  std::rotate(std::begin(expected_order) + 5, std::begin(expected_order) + 6,
+              std::end(expected_order));
+  std::vector<std::string> actual_order;
+  for (const auto& key_and_signer : keys_and_signers)
+    actual_order.push_back(key_and_signer.Get().first.name_.name);
+  EXPECT_EQ(expected_order, actual_order);
+  actual_order.clear();
+  for (auto itr(keys_and_signers.keys_begin()); itr != keys_and_signers.keys_end(); ++itr)
+    actual_order.push_back(itr->name_.name);
+  EXPECT_EQ(expected_order, actual_order);
+
+  // Moving the container keeps its indices usable.
+  FakeKeysAndSigners moved(std::move(keys_and_signers));
+  EXPECT_NE(std::end(moved), moved.Find(FakeName{ key_names[0] }));
+  EXPECT_FALSE(moved.Add(std::make_pair(FakeKey{ key_names[0] }, FakeSigner{ RandomString(64) })));
+  moved.Clear();
+  EXPECT_TRUE(moved.empty());
+  EXPECT_TRUE(moved.Add(std::make_pair(FakeKey{ key_names[0] }, FakeSigner{ signer_names[0] })));
+}
+
+TEST(KeysAndSignersTest, BEH_SerialisedEntriesInEitherFormat) {
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  const std::string pmid_v1(pmid.Serialise(detail::WireFormat::kV1));
+  const std::string pmid_v2(pmid.Serialise(detail::WireFormat::kV2));
+  const std::string anpmid_v1(anpmid.Serialise(detail::WireFormat::kV1));
+  const std::string anpmid_v2(anpmid.Serialise(detail::WireFormat::kV2));
+
+  // Names are read up front from either format, without decoding the fobs.
+  detail::KeysAndSigners<Pmid> pmids;
+  EXPECT_TRUE(pmids.AddSerialised(pmid_v2, anpmid_v1));
+  auto found(pmids.Find(pmid.name()));
+  ASSERT_NE(std::end(pmids), found);
+  EXPECT_FALSE(found->decoded());
+  EXPECT_EQ(anpmid.name(), found->Get().second.name());
+  EXPECT_FALSE(pmids.AddSerialised(pmid_v1, anpmid_v2));
+  EXPECT_THROW(pmids.AddSerialised(pmid_v2.substr(0, pmid_v2.size() - 1), anpmid_v2),
+               maidsafe_error);
+  EXPECT_THROW(pmids.AddSerialised(pmid_v1.substr(0, 8), anpmid_v2), maidsafe_error);
+
+  // An Mpid's name is carried in both formats rather than derived.
+  Anmpid anmpid;
+  Mpid mpid(NonEmptyString(RandomAlphaNumericString(20)), anmpid);
+  detail::KeysAndSigners<Mpid> mpids;
+  EXPECT_TRUE(mpids.AddSerialised(mpid.Serialise(detail::WireFormat::kV2),
+                                  anmpid.Serialise(detail::WireFormat::kV2)));
+  ASSERT_NE(std::end(mpids), mpids.Find(mpid.name()));
+  EXPECT_EQ(mpid.name(), mpids.Find(mpid.name())->Get().first.name());
+}
+
+TEST(KeysAndSignersTest, BEH_CopiesAreUnaffectedByLaterChanges) {
+  // Keep a copy after every addition and every removal, enough of the latter to trigger compaction,
+  // then check each copy still holds exactly what it did when taken.
+  const std::size_t kCount(200);
+  const std::vector<std::string> key_names(RandomNames(kCount)), signer_names(RandomNames(kCount));
+  FakeKeysAndSigners keys_and_signers;
+  std::vector<std::pair<FakeKeysAndSigners, std::vector<std::string>>> copies;
+  std::vector<std::string> held;
+  for (std::size_t i(0); i != kCount; ++i) {
+    ASSERT_TRUE(keys_and_signers.Add(
+        std::make_pair(FakeKey{ key_names[i] }, FakeSigner{ signer_names[i] })));
+    held.push_back(key_names[i]);
+    copies.emplace_back(keys_and_signers, held);
+  }
+  for (std::size_t i(0); i < kCount; i += 2) {
+    keys_and_signers.Remove(keys_and_signers.Find(FakeName{ key_names[i] }));
+    held.erase(std::find(std::begin(held), std::end(held), key_names[i]));
+    copies.emplace_back(keys_and_signers, held);
+  }
+
+  for (const auto& copy : copies) {
+    EXPECT_EQ(copy.second.size(), copy.first.size());
+    std::vector<std::string> actual_order;
+    for (auto itr(copy.first.keys_begin()); itr != copy.first.keys_end(); ++itr)
+      actual_order.push_back(itr->name_.name);
+    EXPECT_EQ(copy.second, actual_order);
+    for (std::size_t i(0); i != kCount; ++i) {
+      const bool expected(std::find(std::begin(copy.second), std::end(copy.second),
+                                    key_names[i]) != std::end(copy.second));
+      EXPECT_EQ(expected, copy.first.Find(FakeName{ key_names[i] }) != std::end(copy.first));
+    }
+  }
+
+  // An iterator keeps its contents alive after the collection is destroyed.
+  auto itr(copies.back().first.begin());
+  copies.clear();
+  keys_and_signers.Clear();
+  EXPECT_EQ(key_names[1], itr->Get().first.name_.name);
+}
+
+TEST(KeysAndSignersTest, FUNC_CopyOnWriteScaling) {
+  // Adds then removes N pairs, replacing the collection with an updated copy each time as Passport
+  // does.  The total should grow close to linearly in N, as each copy shares all but O(log N)
+  // nodes.
+  for (std::size_t count : { 1000U, 10000U, 100000U }) {
+    const std::vector<std::string> key_names(RandomNames(count)), signer_names(RandomNames(count));
+    const auto start(std::chrono::steady_clock::now());
+    std::shared_ptr<const FakeKeysAndSigners> current(std::make_shared<FakeKeysAndSigners>());
+    for (std::size_t i(0); i != count; ++i) {
+      auto updated(std::make_shared<FakeKeysAndSigners>(*current));
+      ASSERT_TRUE(updated->Add(
+          std::make_pair(FakeKey{ key_names[i] }, FakeSigner{ signer_names[i] })));
+      current = std::move(updated);
+    }
+    for (const auto& key_name : key_names) {
+      auto updated(std::make_shared<FakeKeysAndSigners>(*current));
+      updated->Remove(updated->Find(FakeName{ key_name }));
+      current = std::move(updated);
+    }
+    EXPECT_TRUE(current->empty());
+    LOG(kInfo) << count << " copy-on-write adds and removes: "
+               << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+               << "s";
+  }
+}
+
+TEST(KeysAndSignersTest, FUNC_Scaling) {
+  // Adds N pairs with the duplicate check, looks each up, then looks up and removes each, comparing
+  // against the linear scans of a vector which Passport used previously.  Both sides build a name
+  // to look up, as Passport's callers do.  Small sizes are repeated so that each is timed over at
+  // least 10k pairs.  The vector is only timed up to 10k pairs, beyond which its quadratic cost
+  // makes the run impractically long.
+  const std::size_t kLinearLimit(10000);
+  for (std::size_t count : { 10U, 100U, 1000U, 10000U, 100000U }) {
+    const std::vector<std::string> key_names(RandomNames(count)), signer_names(RandomNames(count));
+    const std::size_t repeats(std::max<std::size_t>(1, 10000 / count));
+
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t repeat(0); repeat != repeats; ++repeat) {
+      FakeKeysAndSigners indexed;
+      for (std::size_t i(0); i != count; ++i) {
+        ASSERT_TRUE(indexed.Add(
+            std::make_pair(FakeKey{ key_names[i] }, FakeSigner{ signer_names[i] })));
+      }
+      for (const auto& key_name : key_names)
+        ASSERT_NE(std::end(indexed), indexed.Find(FakeName{ key_name }));
+      for (const auto& key_name : key_names)
+        indexed.Remove(indexed.Find(FakeName{ key_name }));
+      EXPECT_TRUE(indexed.empty());
+    }
+    const double indexed_time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() /
+        repeats);
+
+    if (count > kLinearLimit) {
+      LOG(kInfo) << count << " pairs: indexed " << indexed_time << "s";
+      continue;
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (std::size_t repeat(0); repeat != repeats; ++repeat) {
+      std::vector<std::pair<FakeKey, FakeSigner>> linear;
+      for (std::size_t i(0); i != count; ++i) {
+        FakeKey key{ key_names[i] };
+        FakeSigner signer{ signer_names[i] };
+        ASSERT_TRUE(std::none_of(std::begin(linear), std::end(linear),
+                                 [&](const std::pair<FakeKey, FakeSigner>& existing) {
+                                   return existing.first.name_.name == key.name_.name ||
+                                          existing.second.name_.name == signer.name_.name;
+                                 }));
+        linear.emplace_back(std::move(key), std::move(signer));
+      }
+      auto find([&](const std::string& key_name) {
+        return std::find_if(std::begin(linear), std::end(linear),
+                            [&](const std::pair<FakeKey, FakeSigner>& existing) {
+                              return existing.first.name_.name == key_name;
+                            });
+      });
+      for (const auto& key_name : key_names)
+        ASSERT_NE(std::end(linear), find(FakeName{ key_name }.name));
+      for (const auto& key_name : key_names) {
+        auto itr(find(FakeName{ key_name }.name));
+        ASSERT_NE(std::end(linear), itr);
+        linear.erase(itr);
+      }
+    }
+    const double linear_time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() /
+        repeats);
+    LOG(kInfo) << count << " pairs: indexed " << indexed_time << "s, linear " << linear_time
+               << "s, speedup " << linear_time / indexed_time;
+  }
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -0,0 +1,144 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/test.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+TEST(ParallelTest, BEH_CoversEveryIndexAndReportsLowestError) {
+  const std::size_t kItemCount(1000);
+  std::vector<std::atomic<int>> calls(kItemCount);
+  for (auto& call : calls)
+    call = 0;
+  detail::ParallelFor(kItemCount, 4, [&](std::size_t index) { ++calls[index]; });
+  for (const auto& call : calls)
+    EXPECT_EQ(1, call);
+
+  // However the indices are scheduled, the error reported is that of the lowest failing index.
+  for (int i(0); i != 10; ++i) {
+    try {
+      detail::ParallelFor(kItemCount, 4, [](std::size_t index) {
+        if (index % 100 == 37)
+          throw std::runtime_error(std::to_string(index));
+      });
+      ADD_FAILURE() << "ParallelFor should have thrown.";
+    }
+    catch (const std::runtime_error& error) {
+      EXPECT_EQ(std::string("37"), error.what());
+    }
+  }
+}
+
+TEST(ParallelTest, BEH_ReusesPoolThreads) {
+  // Repeated calls run on the caller and the pool's fixed set of workers, not on new threads.
+  std::mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  for (int i(0); i != 20; ++i) {
+    detail::ParallelFor(64, 0, [&](std::size_t) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      thread_ids.insert(std::this_thread::get_id());
+    });
+  }
+  EXPECT_LE(thread_ids.size(), detail::ThreadPool::Instance().GetThreadCount() + 1U);
+}
+
+TEST(ParallelTest, BEH_NestedLoopsComplete) {
+  // Inner loops may find every pool worker busy with the outer one; they must still complete.
+  std::atomic<std::size_t> total(0);
+  detail::ParallelFor(16, 0, [&](std::size_t) {
+    detail::ParallelFor(16, 0, [&](std::size_t) { ++total; });
+  });
+  EXPECT_EQ(256U, total);
+}
+
+TEST(ParallelTest, BEH_ThreadPoolPostAndConfigure) {
+  detail::ThreadPool thread_pool(2);
+  EXPECT_EQ(2U, thread_pool.GetThreadCount());
+  std::mutex mutex;
+  std::condition_variable condition;
+  int done(0);
+  auto task([&] {
+    std::lock_guard<std::mutex> lock{ mutex };
+    ++done;
+    condition.notify_all();
+  });
+  thread_pool.Post(task);
+  thread_pool.Configure(3);
+  EXPECT_EQ(3U, thread_pool.GetThreadCount());
+  thread_pool.Post(task);
+  thread_pool.Post([] { throw std::runtime_error("dropped"); });
+  thread_pool.Post(task);
+  std::unique_lock<std::mutex> lock{ mutex };
+  EXPECT_TRUE(condition.wait_for(lock, std::chrono::seconds(10), [&] { return done == 3; }));
+}
+
+TEST(ParallelTest, BEH_ConfigureFromWorkerThrows) {
+  detail::ThreadPool thread_pool(2), other_pool(1);
+  std::mutex mutex;
+  std::condition_variable condition;
+  int thrown(0), configured(0);
+  thread_pool.Post([&] {
+    try {
+      thread_pool.Configure(4);
+    }
+    catch (const maidsafe_error&) {
+      std::lock_guard<std::mutex> lock{ mutex };
+      ++thrown;
+      condition.notify_all();
+    }
+    // Another pool can still be configured from here.
+    other_pool.Configure(2);
+    std::lock_guard<std::mutex> lock{ mutex };
+    ++configured;
+    condition.notify_all();
+  });
+  {
+    std::unique_lock<std::mutex> lock{ mutex };
+    EXPECT_TRUE(condition.wait_for(lock, std::chrono::seconds(10),
+                                   [&] { return configured == 1; }));
+    EXPECT_EQ(1, thrown);
+  }
+  EXPECT_EQ(2U, thread_pool.GetThreadCount());
+  EXPECT_EQ(2U, other_pool.GetThreadCount());
+  thread_pool.Configure(3);
+  EXPECT_EQ(3U, thread_pool.GetThreadCount());
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -18,9 +18,18 @@
 
 #include "maidsafe/passport/passport.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
 #include <future>
+#include <iterator>
 #include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "maidsafe/common/error.h"
 #include "maidsafe/common/log.h"
@@ -28,8 +37,12 @@
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 #include "maidsafe/common/authentication/user_credentials.h"
+#include "maidsafe/common/serialisation/serialisation.h"
 
 #include "maidsafe/passport/detail/fob.h"
+#include "maidsafe/passport/detail/fob_cereal.h"
+#include "maidsafe/passport/detail/key_pool.h"
+#include "maidsafe/passport/detail/passport_cereal.h"
 
 namespace maidsafe {
 
@@ -91,6 +104,82 @@ TEST(PassportTest, BEH_FreeFunctions) {
                   maidsafe_error);
 }
 
+template <typename KeyAndSigner>
+bool ValidKeyAndSigner(const KeyAndSigner& key_and_signer) {
+  return asymm::CheckSignature(
+      asymm::PlainText{ asymm::EncodeKey(key_and_signer.first.public_key()) },
+      key_and_signer.first.validation_token(), key_and_signer.second.public_key());
+}
+
+TEST(PassportTest, FUNC_BatchCreation) {
+  const std::size_t kCount(8);
+  std::vector<MaidAndSigner> maids_and_signers{ CreateMaidAndSignerBatch(kCount, 3) };
+  std::vector<PmidAndSigner> pmids_and_signers{ CreatePmidAndSignerBatch(kCount, 3) };
+  std::vector<NonEmptyString> chosen_names;
+  for (std::size_t i(0); i != kCount; ++i)
+    chosen_names.emplace_back(std::to_string(i));
+  std::vector<MpidAndSigner> mpids_and_signers{ CreateMpidAndSignerBatch(chosen_names, 3) };
+
+  ASSERT_EQ(kCount, maids_and_signers.size());
+  ASSERT_EQ(kCount, pmids_and_signers.size());
+  ASSERT_EQ(kCount, mpids_and_signers.size());
+  std::set<std::string> names;
+  for (std::size_t i(0); i != kCount; ++i) {
+    EXPECT_TRUE(ValidKeyAndSigner(maids_and_signers[i]));
+    EXPECT_TRUE(ValidKeyAndSigner(pmids_and_signers[i]));
+    EXPECT_TRUE(ValidKeyAndSigner(mpids_and_signers[i]));
+    EXPECT_EQ(detail::CreateMpidName(chosen_names[i]), mpids_and_signers[i].first.name().value);
+    names.insert(maids_and_signers[i].first.name()->string());
+    names.insert(pmids_and_signers[i].first.name()->string());
+  }
+  EXPECT_EQ(2 * kCount, names.size());
+
+  EXPECT_TRUE(CreatePmidAndSignerBatch(0).empty());
+  EXPECT_TRUE(CreateMpidAndSignerBatch(std::vector<NonEmptyString>{}).empty());
+}
+
+namespace {
+
+// Applies 'config' to the process-wide KeyPool, restoring the original however the scope is left.
+class ScopedKeyPoolConfig {
+ public:
+  explicit ScopedKeyPoolConfig(detail::KeyPool::Config config)
+      : original_config_(detail::KeyPool::Instance().GetConfig()) {
+    detail::KeyPool::Instance().Configure(std::move(config));
+  }
+  ~ScopedKeyPoolConfig() { detail::KeyPool::Instance().Configure(original_config_); }
+
+ private:
+  ScopedKeyPoolConfig(const ScopedKeyPoolConfig&) = delete;
+  ScopedKeyPoolConfig(ScopedKeyPoolConfig&&) = delete;
+  ScopedKeyPoolConfig& operator=(ScopedKeyPoolConfig) = delete;
+
+  const detail::KeyPool::Config original_config_;
+};
+
+}  // unnamed namespace
+
+TEST(PassportTest, FUNC_BatchCreationScaling) {
+  // Measure raw generation rather than pool draining.
+  const ScopedKeyPoolConfig disabled_key_pool(detail::KeyPool::Config(0, 0, 0));
+
+  const std::size_t kCount(32);
+  const unsigned kMaxThreads(std::max(1U, std::thread::hardware_concurrency()));
+  double single_thread_rate(0.0);
+  for (unsigned thread_count(1); thread_count <= kMaxThreads; thread_count *= 2) {
+    auto start(std::chrono::steady_clock::now());
+    std::vector<PmidAndSigner> pmids_and_signers{ CreatePmidAndSignerBatch(kCount,
+                                                                           thread_count) };
+    std::chrono::duration<double> elapsed(std::chrono::steady_clock::now() - start);
+    ASSERT_EQ(kCount, pmids_and_signers.size());
+    const double rate(kCount / elapsed.count());
+    if (thread_count == 1)
+      single_thread_rate = rate;
+    LOG(kInfo) << "CreatePmidAndSignerBatch with " << thread_count << " thread(s): " << rate
+               << " pairs/s, speedup " << rate / single_thread_rate;
+  }
+}
+
 authentication::UserCredentials CreateUserCredentials() {
   authentication::UserCredentials user_credentials;
   user_credentials.keyword = maidsafe::make_unique<authentication::UserCredentials::Keyword>(
@@ -344,6 +433,434 @@ TEST(PassportTest, FUNC_Encrypt) {
     EXPECT_TRUE(AllFieldsMatch(*mpids_itr++, (*mpids_and_signers_itr++).first));
 }
 
+TEST(PassportTest, FUNC_EnvelopeEncryption) {
+  MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  Passport passport{ maid_and_signer };
+  for (const auto& pmid_and_signer : CreatePmidAndSignerBatch(8))
+    passport.AddKeyAndSigner(pmid_and_signer);
+  authentication::UserCredentials old_credentials{ CreateUserCredentials() };
+  authentication::UserCredentials new_credentials{ CreateUserCredentials() };
+  const CredentialSession old_session{ old_credentials }, new_session{ new_credentials };
+
+  // Both formats decrypt through the same constructors.
+  const crypto::CipherText direct{ passport.Encrypt(old_session) };
+  const crypto::CipherText envelope{ passport.Encrypt(old_session, EncryptionFormat::kEnvelope) };
+  EXPECT_NE(direct, envelope);
+  for (const auto& encrypted : { direct, envelope }) {
+    Passport decrypted{ encrypted, old_credentials };
+    EXPECT_TRUE(AllFieldsMatch(maid_and_signer.first, decrypted.GetMaid()));
+    EXPECT_EQ(8U, decrypted.GetPmids().size());
+    EXPECT_THROW(Passport(encrypted, new_session), maidsafe_error);
+  }
+
+  // Rewrapping changes only the wrapped key, leaving the encrypted body byte-for-byte intact.
+  auto start(std::chrono::steady_clock::now());
+  const crypto::CipherText rewrapped{ RewrapPassport(envelope, old_session, new_session) };
+  const double rewrap_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  ASSERT_EQ(envelope->string().size(), rewrapped->string().size());
+  const std::size_t body_size(envelope->string().size() / 2);
+  EXPECT_EQ(envelope->string().substr(envelope->string().size() - body_size),
+            rewrapped->string().substr(rewrapped->string().size() - body_size));
+  EXPECT_NE(envelope, rewrapped);
+  Passport decrypted{ rewrapped, new_session };
+  EXPECT_TRUE(AllFieldsMatch(maid_and_signer.first, decrypted.GetMaid()));
+  EXPECT_EQ(8U, decrypted.GetPmids().size());
+  EXPECT_THROW(Passport(rewrapped, old_session), maidsafe_error);
+
+  start = std::chrono::steady_clock::now();
+  Passport(direct, old_session).Encrypt(new_session);
+  const double reencrypt_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  LOG(kInfo) << "Credential change: rewrap " << rewrap_time << "s, full re-encryption "
+             << reencrypt_time << "s";
+
+  // Only envelopes can be rewrapped, and only with the right credentials.
+  EXPECT_THROW(RewrapPassport(direct, old_session, new_session), maidsafe_error);
+  EXPECT_THROW(RewrapPassport(envelope, new_session, old_session), maidsafe_error);
+}
+
+TEST(PassportTest, FUNC_SerialisationCache) {
+  MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  Passport passport{ maid_and_signer };
+  const CredentialSession session{ CreateUserCredentials() };
+
+  // Unchanged passports reuse the serialised form.
+  const crypto::CipherText first{ passport.Encrypt(session) };
+  EXPECT_EQ(first, passport.Encrypt(session));
+  EXPECT_EQ(1U, passport.GetSerialisationStatistics().rebuilds);
+  EXPECT_EQ(1U, passport.GetSerialisationStatistics().cache_hits);
+
+  // Each mutator invalidates it.
+  PmidAndSigner pmid_and_signer{ CreatePmidAndSigner() };
+  MpidAndSigner mpid_and_signer{ CreateMpidAndSigner(NonEmptyString{ RandomString(10) }) };
+  MaidAndSigner new_maid_and_signer{ CreateMaidAndSigner() };
+  std::vector<std::function<void()>> mutators{
+      [&] { passport.AddKeyAndSigner(pmid_and_signer); },
+      [&] { passport.AddKeyAndSigner(mpid_and_signer); },
+      [&] { passport.RemoveKeyAndSigner(pmid_and_signer.first); },
+      [&] { passport.RemoveKeyAndSigner(mpid_and_signer.first); },
+      [&] { passport.ReplaceMaidAndSigner(maid_and_signer.first, new_maid_and_signer); } };
+  std::uint64_t expected_rebuilds(1);
+  for (const auto& mutate : mutators) {
+    mutate();
+    const crypto::CipherText encrypted{ passport.Encrypt(session) };
+    EXPECT_EQ(++expected_rebuilds, passport.GetSerialisationStatistics().rebuilds);
+    const Passport decrypted{ encrypted, session };
+    EXPECT_EQ(passport.GetMaid().name(), decrypted.GetMaid().name());
+    EXPECT_EQ(passport.GetPmids().size(), decrypted.GetPmids().size());
+    EXPECT_EQ(passport.GetMpids().size(), decrypted.GetMpids().size());
+  }
+
+  // A failed mutation leaves the cache valid.
+  EXPECT_THROW(passport.RemoveKeyAndSigner(pmid_and_signer.first), maidsafe_error);
+  passport.Encrypt(session);
+  EXPECT_EQ(expected_rebuilds, passport.GetSerialisationStatistics().rebuilds);
+  EXPECT_EQ(2U, passport.GetSerialisationStatistics().cache_hits);
+
+  // Time repeated saves of an unchanged passport holding several keys.
+  for (const auto& created_pmid_and_signer : CreatePmidAndSignerBatch(16))
+    passport.AddKeyAndSigner(created_pmid_and_signer);
+  const std::size_t kSaveCount(100);
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t i(0); i != kSaveCount; ++i)
+    passport.Encrypt(session);
+  const double elapsed(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const Passport::SerialisationStatistics statistics(passport.GetSerialisationStatistics());
+  LOG(kInfo) << kSaveCount << " saves of an unchanged passport in " << elapsed << "s; "
+             << statistics.cache_hits << " cache hits, " << statistics.rebuilds << " rebuilds";
+}
+
+namespace {
+
+// Encrypts 'cereal_passport' as Passport::Encrypt does in the direct format.
+crypto::CipherText EncryptCereal(const detail::PassportCereal& cereal_passport,
+                                 const CredentialSession& session) {
+  return crypto::SymmEncrypt(
+      session.Obfuscate(NonEmptyString{ maidsafe::ConvertToString(cereal_passport) }),
+      session.symm_key(), session.symm_iv());
+}
+
+// Returns 'serialised_fob' with a random validation token and the matching name.  Parsing checks a
+// fob's name against its public key and token but not the token's signer, so this gives any number
+// of distinct, valid entries without generating a key pair for each.
+std::string Retoken(const std::string& serialised_fob) {
+  detail::FobCereal fob_cereal;
+  maidsafe::ConvertFromString(serialised_fob, fob_cereal);
+  fob_cereal.validation_token_ =
+      asymm::Signature{ RandomString(fob_cereal.validation_token_.string().size()) };
+  fob_cereal.name_ = Identity{
+      crypto::Hash<crypto::SHA512>(fob_cereal.public_key_ + fob_cereal.validation_token_) };
+  return maidsafe::ConvertToString(fob_cereal);
+}
+
+// A passport holding 'maid_and_signer' and 'count' Pmids, re-tokened from a small set of generated
+// pairs.
+detail::PassportCereal CreateLargePassportCereal(const MaidAndSigner& maid_and_signer,
+                                                 std::size_t count) {
+  std::vector<std::pair<std::string, std::string>> templates;
+  for (const auto& pmid_and_signer : CreatePmidAndSignerBatch(16))
+    templates.emplace_back(pmid_and_signer.first.ToCereal(), pmid_and_signer.second.ToCereal());
+  detail::PassportCereal cereal_passport;
+  cereal_passport.maid_and_signer_.key_ = maid_and_signer.first.ToCereal();
+  cereal_passport.maid_and_signer_.signer_ = maid_and_signer.second.ToCereal();
+  cereal_passport.pmids_and_signers_.resize(count);
+  for (std::size_t i(0); i != count; ++i) {
+    cereal_passport.pmids_and_signers_[i].key_ = Retoken(templates[i % templates.size()].first);
+    cereal_passport.pmids_and_signers_[i].signer_ =
+        Retoken(templates[i % templates.size()].second);
+  }
+  return cereal_passport;
+}
+
+}  // unnamed namespace
+
+TEST(PassportTest, BEH_ParseOrderAndErrors) {
+  const CredentialSession session{ CreateUserCredentials() };
+  MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  std::vector<PmidAndSigner> pmids_and_signers(CreatePmidAndSignerBatch(16));
+  detail::PassportCereal cereal_passport;
+  cereal_passport.maid_and_signer_.key_ = maid_and_signer.first.ToCereal();
+  cereal_passport.maid_and_signer_.signer_ = maid_and_signer.second.ToCereal();
+  for (const auto& pmid_and_signer : pmids_and_signers) {
+    cereal_passport.pmids_and_signers_.emplace_back();
+    cereal_passport.pmids_and_signers_.back().key_ = pmid_and_signer.first.ToCereal();
+    cereal_passport.pmids_and_signers_.back().signer_ = pmid_and_signer.second.ToCereal();
+  }
+
+  // Order is preserved, and re-serialising reproduces the original bytes.
+  const Passport passport{ EncryptCereal(cereal_passport, session), session };
+  EXPECT_EQ(EncryptCereal(cereal_passport, session), passport.Encrypt(session));
+  const std::vector<Pmid> pmids(passport.GetPmids());
+  ASSERT_EQ(pmids_and_signers.size(), pmids.size());
+  for (std::size_t i(0); i != pmids.size(); ++i)
+    EXPECT_TRUE(AllFieldsMatch(pmids_and_signers[i].first, pmids[i]));
+
+  // Signers are validated like the keys they sign unless deferral is asked for, in which case their
+  // private keys are only decoded when first used.
+  Passport modifiable{ EncryptCereal(cereal_passport, session), session };
+  const Anpmid anpmid(modifiable.RemoveKeyAndSigner(pmids_and_signers[0].first));
+  EXPECT_TRUE(anpmid.private_key_decoded());
+  EXPECT_TRUE(AllFieldsMatch(pmids_and_signers[0].second, anpmid));
+  Passport deferred{ EncryptCereal(cereal_passport, session), session, LoadMode::kEager,
+                     detail::ValidationMode::kKeyConsistency, SignerValidation::kDefer };
+  const Anpmid deferred_anpmid(deferred.RemoveKeyAndSigner(pmids_and_signers[0].first));
+  EXPECT_FALSE(deferred_anpmid.private_key_decoded());
+  EXPECT_TRUE(AllFieldsMatch(pmids_and_signers[0].second, deferred_anpmid));
+
+  // So a signer with another's private key, but a valid name, is rejected up front by default.
+  detail::PassportCereal mismatched(cereal_passport);
+  detail::FobCereal signer_cereal;
+  maidsafe::ConvertFromString(mismatched.pmids_and_signers_[0].signer_, signer_cereal);
+  signer_cereal.private_key_ = asymm::EncodeKey(pmids_and_signers[1].second.private_key());
+  mismatched.pmids_and_signers_[0].signer_ = maidsafe::ConvertToString(signer_cereal);
+  const crypto::CipherText encrypted_mismatched{ EncryptCereal(mismatched, session) };
+  EXPECT_THROW(Passport(encrypted_mismatched, session), maidsafe_error);
+  const Passport lazy_mismatched{ encrypted_mismatched, session, LoadMode::kLazy };
+  EXPECT_THROW(lazy_mismatched.GetPmids(), maidsafe_error);
+  Passport deferred_mismatched{ encrypted_mismatched, session, LoadMode::kEager,
+                                detail::ValidationMode::kKeyConsistency,
+                                SignerValidation::kDefer };
+  const Anpmid mismatched_anpmid(
+      deferred_mismatched.RemoveKeyAndSigner(pmids_and_signers[0].first));
+  EXPECT_THROW(mismatched_anpmid.private_key(), maidsafe_error);
+
+  // Any corrupt entry fails the whole parse, however many there are.
+  for (std::size_t i(0); i != 4; ++i) {
+    detail::PassportCereal corrupted(cereal_passport);
+    auto& entry(corrupted.pmids_and_signers_[RandomUint32() % corrupted.pmids_and_signers_.size()]);
+    (i % 2 == 0 ? entry.key_ : entry.signer_) = RandomString(100);
+    EXPECT_THROW(Passport(EncryptCereal(corrupted, session), session), maidsafe_error);
+  }
+
+  // As does a duplicated one.
+  detail::PassportCereal duplicated(cereal_passport);
+  duplicated.pmids_and_signers_.push_back(duplicated.pmids_and_signers_.front());
+  EXPECT_THROW(Passport(EncryptCereal(duplicated, session), session), maidsafe_error);
+}
+
+TEST(PassportTest, BEH_ParseCache) {
+  struct DisableOnExit {
+    ~DisableOnExit() { ConfigureParseCache(0); }
+  } disable_on_exit;
+  const CredentialSession session{ CreateUserCredentials() };
+  Passport original{ CreateMaidAndSigner() };
+  for (const auto& pmid_and_signer : CreatePmidAndSignerBatch(4))
+    original.AddKeyAndSigner(pmid_and_signer);
+  const crypto::CipherText encrypted{ original.Encrypt(session) };
+
+  // Disabled by default.
+  const Passport uncached{ encrypted, session };
+  EXPECT_EQ(0U, GetParseCacheStatistics().misses);
+
+  // Each of the ten fobs misses once, then hits on every reload.
+  ConfigureParseCache(1024 * 1024);
+  const Passport first{ encrypted, session };
+  detail::FobCacheStatistics statistics(GetParseCacheStatistics());
+  EXPECT_EQ(0U, statistics.hits);
+  EXPECT_EQ(10U, statistics.misses);
+  EXPECT_EQ(10U, statistics.entry_count);
+  const Passport second{ encrypted, session };
+  statistics = GetParseCacheStatistics();
+  EXPECT_EQ(10U, statistics.hits);
+  EXPECT_EQ(10U, statistics.misses);
+  EXPECT_TRUE(AllFieldsMatch(original.GetMaid(), second.GetMaid()));
+  const std::vector<Pmid> original_pmids(original.GetPmids()), second_pmids(second.GetPmids());
+  ASSERT_EQ(original_pmids.size(), second_pmids.size());
+  for (std::size_t i(0); i != original_pmids.size(); ++i)
+    EXPECT_TRUE(AllFieldsMatch(original_pmids[i], second_pmids[i]));
+  EXPECT_EQ(encrypted, second.Encrypt(session));
+
+  // Entries are cached per validation mode, so a stronger check isn't served by a weaker one.
+  const std::uint64_t round_trips_before(detail::GetValidationStatistics().round_trips);
+  const Passport round_tripped{ encrypted, session, LoadMode::kEager,
+                                detail::ValidationMode::kRoundTrip };
+  statistics = GetParseCacheStatistics();
+  EXPECT_EQ(10U, statistics.hits);
+  EXPECT_EQ(20U, statistics.misses);
+  EXPECT_GE(detail::GetValidationStatistics().round_trips, round_trips_before + 10);
+  EXPECT_EQ(encrypted, round_tripped.Encrypt(session));
+
+  // Disabling frees the caches.
+  ConfigureParseCache(0);
+  EXPECT_EQ(0U, GetParseCacheStatistics().entry_count);
+}
+
+TEST(PassportTest, FUNC_ParseScaling) {
+  // Compares loading an encrypted passport against reconstructing the same entries one at a time,
+  // as Parse did before it was parallelised.
+  const CredentialSession session{ CreateUserCredentials() };
+  const MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  for (std::size_t count : { 1U, 100U, 10000U }) {
+    const crypto::CipherText encrypted{
+        EncryptCereal(CreateLargePassportCereal(maid_and_signer, count), session) };
+
+    auto start(std::chrono::steady_clock::now());
+    const Passport loaded{ encrypted, session };
+    const double parallel_time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    EXPECT_EQ(count, loaded.GetPmids().size());
+
+    start = std::chrono::steady_clock::now();
+    detail::PassportCereal cereal_passport;
+    maidsafe::ConvertFromString(
+        session.Obfuscate(crypto::SymmDecrypt(encrypted, session.symm_key(), session.symm_iv()))
+            .string(),
+        cereal_passport);
+    Maid maid{ cereal_passport.maid_and_signer_.key_ };
+    Anmaid anmaid{ cereal_passport.maid_and_signer_.signer_ };
+    std::vector<PmidAndSigner> pmids_and_signers;
+    for (const auto& entry : cereal_passport.pmids_and_signers_)
+      pmids_and_signers.emplace_back(Pmid{ entry.key_ }, Anpmid{ entry.signer_ });
+    const double sequential_time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    LOG(kInfo) << "Loading a passport with " << count << " Pmid(s): parallel " << parallel_time
+               << "s, sequential " << sequential_time << "s, speedup "
+               << sequential_time / parallel_time;
+  }
+}
+
+TEST(PassportTest, FUNC_ParseValidationModeThroughput) {
+  const CredentialSession session{ CreateUserCredentials() };
+  const MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  const std::size_t kPmidCount(1000);
+  const crypto::CipherText encrypted{
+      EncryptCereal(CreateLargePassportCereal(maid_and_signer, kPmidCount), session) };
+
+  auto time_parsing([&](detail::ValidationMode mode) {
+    auto start(std::chrono::steady_clock::now());
+    const Passport loaded{ encrypted, session, LoadMode::kEager, mode };
+    const double elapsed(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    EXPECT_EQ(kPmidCount, loaded.GetPmids().size());
+    return elapsed;
+  });
+
+  const double round_trip(time_parsing(detail::ValidationMode::kRoundTrip));
+  const double key_consistency(time_parsing(detail::ValidationMode::kKeyConsistency));
+  LOG(kInfo) << "Parsing a passport with " << kPmidCount << " Pmids: round trip " << round_trip
+             << "s (" << kPmidCount / round_trip << " entries/s), key consistency "
+             << key_consistency << "s (" << kPmidCount / key_consistency
+             << " entries/s), speedup " << round_trip / key_consistency;
+}
+
+TEST(PassportTest, BEH_LazyLoad) {
+  const CredentialSession session{ CreateUserCredentials() };
+  Passport original{ CreateMaidAndSigner() };
+  std::vector<PmidAndSigner> pmids_and_signers(CreatePmidAndSignerBatch(8));
+  for (const auto& pmid_and_signer : pmids_and_signers)
+    original.AddKeyAndSigner(pmid_and_signer);
+  original.AddKeyAndSigner(CreateMpidAndSigner(NonEmptyString{ RandomString(10) }));
+  const crypto::CipherText encrypted{ original.Encrypt(session) };
+
+  // Nothing is decoded until accessed, and untouched entries re-encrypt to the same bytes.
+  const Passport lazy{ encrypted, session, LoadMode::kLazy };
+  const Passport::Snapshot snapshot(lazy.GetSnapshot());
+  for (auto itr(std::begin(snapshot.GetPmids()).base());
+       itr != std::end(snapshot.GetPmids()).base(); ++itr) {
+    EXPECT_FALSE(itr->decoded());
+  }
+  EXPECT_EQ(encrypted, lazy.Encrypt(session));
+  EXPECT_FALSE(std::begin(snapshot.GetPmids()).base()->decoded());
+
+  // Accessing an entry decodes it alone.
+  const Pmid* const pmid(snapshot.FindPmid(pmids_and_signers[3].first.name()));
+  ASSERT_NE(nullptr, pmid);
+  EXPECT_TRUE(AllFieldsMatch(pmids_and_signers[3].first, *pmid));
+  auto itr(std::begin(snapshot.GetPmids()).base());
+  for (std::size_t i(0); i != pmids_and_signers.size(); ++i, ++itr)
+    EXPECT_EQ(i == 3, itr->decoded());
+
+  const std::vector<Pmid> pmids(lazy.GetPmids());
+  ASSERT_EQ(pmids_and_signers.size(), pmids.size());
+  for (std::size_t i(0); i != pmids.size(); ++i)
+    EXPECT_TRUE(AllFieldsMatch(pmids_and_signers[i].first, pmids[i]));
+  EXPECT_EQ(1U, lazy.GetMpids().size());
+  EXPECT_EQ(encrypted, lazy.Encrypt(session));
+
+  // An entry whose names are readable but which fails validation is only reported on access.
+  detail::PassportCereal cereal_passport;
+  maidsafe::ConvertFromString(
+      session.Obfuscate(crypto::SymmDecrypt(encrypted, session.symm_key(), session.symm_iv()))
+          .string(),
+      cereal_passport);
+  detail::FobCereal fob_cereal;
+  maidsafe::ConvertFromString(cereal_passport.pmids_and_signers_[5].key_, fob_cereal);
+  fob_cereal.validation_token_ =
+      asymm::Signature{ RandomString(fob_cereal.validation_token_.string().size()) };
+  cereal_passport.pmids_and_signers_[5].key_ = maidsafe::ConvertToString(fob_cereal);
+  const crypto::CipherText corrupted{ EncryptCereal(cereal_passport, session) };
+  EXPECT_THROW(Passport(corrupted, session), maidsafe_error);
+  const Passport corrupt_lazy{ corrupted, session, LoadMode::kLazy };
+  const Passport::Snapshot corrupt_snapshot(corrupt_lazy.GetSnapshot());
+  EXPECT_NE(nullptr, corrupt_snapshot.FindPmid(pmids_and_signers[4].first.name()));
+  EXPECT_THROW(corrupt_snapshot.FindPmid(pmids_and_signers[5].first.name()), maidsafe_error);
+  EXPECT_THROW(corrupt_lazy.GetPmids(), maidsafe_error);
+  EXPECT_THROW(corrupt_lazy.GetPmids(), maidsafe_error);
+}
+
+TEST(PassportTest, FUNC_LazyLoadScaling) {
+  // Compares the time until the Maid is usable after an eager and a lazy load.
+  const CredentialSession session{ CreateUserCredentials() };
+  const MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  for (std::size_t count : { 1U, 100U, 10000U }) {
+    const crypto::CipherText encrypted{
+        EncryptCereal(CreateLargePassportCereal(maid_and_signer, count), session) };
+
+    double times[2];
+    for (LoadMode load_mode : { LoadMode::kEager, LoadMode::kLazy }) {
+      const auto start(std::chrono::steady_clock::now());
+      const Passport loaded{ encrypted, session, load_mode };
+      EXPECT_TRUE(AllFieldsMatch(maid_and_signer.first, loaded.GetMaid()));
+      times[static_cast<int>(load_mode)] =
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    LOG(kInfo) << "Time to first Maid with " << count << " Pmid(s): eager " << times[0]
+               << "s, lazy " << times[1] << "s";
+  }
+}
+
+TEST(PassportTest, BEH_Snapshot) {
+  MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
+  Passport passport{ maid_and_signer };
+  PmidAndSigner pmid_and_signer{ CreatePmidAndSigner() };
+  MpidAndSigner mpid_and_signer{ CreateMpidAndSigner(NonEmptyString{ RandomString(10) }) };
+  passport.AddKeyAndSigner(pmid_and_signer);
+
+  const Passport::Snapshot before(passport.GetSnapshot());
+  EXPECT_TRUE(AllFieldsMatch(maid_and_signer.first, before.GetMaid()));
+  ASSERT_EQ(1, std::distance(std::begin(before.GetPmids()), std::end(before.GetPmids())));
+  EXPECT_TRUE(AllFieldsMatch(pmid_and_signer.first, *std::begin(before.GetPmids())));
+  EXPECT_TRUE(before.GetMpids().empty());
+  ASSERT_NE(nullptr, before.FindPmid(pmid_and_signer.first.name()));
+  EXPECT_TRUE(AllFieldsMatch(pmid_and_signer.first,
+                             *before.FindPmid(pmid_and_signer.first.name())));
+  EXPECT_EQ(nullptr, before.FindMpid(mpid_and_signer.first.name()));
+
+  // Later changes are visible in new snapshots only.
+  passport.AddKeyAndSigner(mpid_and_signer);
+  passport.RemoveKeyAndSigner(pmid_and_signer.first);
+  passport.RemoveKeyAndSigner(maid_and_signer.first);
+  const Passport::Snapshot after(passport.GetSnapshot());
+  EXPECT_THROW(after.GetMaid(), maidsafe_error);
+  EXPECT_TRUE(after.GetPmids().empty());
+  EXPECT_EQ(nullptr, after.FindPmid(pmid_and_signer.first.name()));
+  ASSERT_NE(nullptr, after.FindMpid(mpid_and_signer.first.name()));
+  EXPECT_TRUE(AllFieldsMatch(mpid_and_signer.first, *after.FindMpid(mpid_and_signer.first.name())));
+
+  EXPECT_TRUE(AllFieldsMatch(maid_and_signer.first, before.GetMaid()));
+  EXPECT_NE(nullptr, before.FindPmid(pmid_and_signer.first.name()));
+  EXPECT_EQ(nullptr, before.FindMpid(mpid_and_signer.first.name()));
+
+  // A range outlives the temporary snapshot it was taken from.
+  const Passport::Snapshot::MpidRange mpids(passport.GetSnapshot().GetMpids());
+  ASSERT_EQ(1, std::distance(std::begin(mpids), std::end(mpids)));
+  EXPECT_TRUE(AllFieldsMatch(mpid_and_signer.first, *std::begin(mpids)));
+}
+
 TEST(PassportTest, FUNC_ParallelAddsEncryptsAndRemoves) {
   MaidAndSigner maid_and_signer{ CreateMaidAndSigner() };
   Passport passport{ maid_and_signer };
@@ -432,6 +949,62 @@ TEST(PassportTest, FUNC_ParallelAddsEncryptsAndRemoves) {
   for (auto& get_mpids_future : get_mpids_futures) {
     EXPECT_NO_THROW(get_mpids_future.get());
   }
+
+  // Measure read throughput against the number of reading threads while a writer repeatedly adds
+  // and removes a Pmid.  With shared locking, reads should scale with the thread count rather than
+  // queueing behind one another.
+  for (const auto& pmid_and_signer : pmids_and_signers)
+    passport.AddKeyAndSigner(pmid_and_signer);
+  PmidAndSigner churned_pmid_and_signer{ CreatePmidAndSigner() };
+  const std::size_t kReadsPerThread(2000);
+  const unsigned kMaxThreads(std::max(4U, std::thread::hardware_concurrency()));
+  for (unsigned thread_count(1); thread_count <= kMaxThreads; thread_count *= 2) {
+    std::atomic<bool> stop_writer(false);
+    std::future<std::size_t> writer_future{ std::async(std::launch::async, [&] {
+      std::size_t write_count(0);
+      while (!stop_writer) {
+        passport.AddKeyAndSigner(churned_pmid_and_signer);
+        passport.RemoveKeyAndSigner(churned_pmid_and_signer.first);
+        write_count += 2;
+      }
+      return write_count;
+    }) };
+
+    auto start(std::chrono::steady_clock::now());
+    std::vector<std::future<void>> reader_futures;
+    for (unsigned i(0); i != thread_count; ++i) {
+      reader_futures.emplace_back(std::async(std::launch::async, [&] {
+        for (std::size_t j(0); j != kReadsPerThread; ++j) {
+          switch (j % 4) {
+            case 0:
+              passport.GetMaid();
+              break;
+            case 1:
+              passport.GetPmids();
+              break;
+            case 2:
+              passport.GetMpids();
+              break;
+            default:
+              EXPECT_NE(nullptr,
+                        passport.GetSnapshot().FindPmid(pmids_and_signers[0].first.name()));
+          }
+        }
+      }));
+    }
+    for (auto& reader_future : reader_futures)
+      EXPECT_NO_THROW(reader_future.get());
+    const double elapsed(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    stop_writer = true;
+    std::size_t write_count(0);
+    EXPECT_NO_THROW(write_count = writer_future.get());
+    LOG(kInfo) << thread_count << " reader thread(s): "
+               << static_cast<double>(thread_count * kReadsPerThread) / elapsed
+               << " reads/s alongside " << static_cast<double>(write_count) / elapsed
+               << " writes/s";
+  }
+  EXPECT_EQ(pmids_and_signers.size(), passport.GetPmids().size());
 }
 
 }  // namespace test
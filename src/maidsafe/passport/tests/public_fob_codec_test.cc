@@ -0,0 +1,178 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/public_fob_codec.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+#include "maidsafe/passport/tests/allocation_counter.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+namespace {
+
+std::vector<PublicPmid> MakePublicPmids(std::size_t count) {
+  std::vector<PublicPmid> public_pmids;
+  for (std::size_t i(0); i != count; ++i) {
+    Anpmid anpmid;
+    public_pmids.emplace_back(Pmid(anpmid));
+  }
+  return public_pmids;
+}
+
+}  // unnamed namespace
+
+TEST(PublicFobCodecTest, BEH_EncodeDecodeAndRandomAccess) {
+  const std::vector<PublicPmid> public_pmids(MakePublicPmids(5));
+  const std::string encoded(detail::EncodePublicFobs(public_pmids));
+
+  const std::vector<PublicPmid> decoded(detail::DecodePublicFobs<detail::PmidTag>(encoded));
+  ASSERT_EQ(public_pmids.size(), decoded.size());
+  for (std::size_t i(0); i != public_pmids.size(); ++i) {
+    EXPECT_EQ(public_pmids[i].name(), decoded[i].name());
+    EXPECT_EQ(public_pmids[i].Serialise(), decoded[i].Serialise());
+  }
+  EXPECT_EQ(encoded, detail::EncodePublicFobs(decoded));
+  const std::vector<PublicPmid> single_threaded(
+      detail::DecodePublicFobs<detail::PmidTag>(encoded, 1));
+  ASSERT_EQ(public_pmids.size(), single_threaded.size());
+  EXPECT_EQ(public_pmids.back().Serialise(), single_threaded.back().Serialise());
+
+  // Any one element can be read in place or decoded without the others.
+  const detail::PublicFobsView<detail::PmidTag> view(encoded);
+  ASSERT_EQ(public_pmids.size(), view.size());
+  EXPECT_FALSE(view.empty());
+  const PublicPmidView third(view.View(2));
+  EXPECT_EQ(public_pmids[2].encoded_public_key().string(), third.encoded_public_key());
+  EXPECT_EQ(public_pmids[2].Serialise(detail::WireFormat::kV2)->string(), third.serialised());
+  EXPECT_EQ(public_pmids[3].name(), view.Decode(3).name());
+  EXPECT_THROW(view.View(public_pmids.size()), maidsafe_error);
+  EXPECT_THROW(view.Decode(public_pmids.size()), maidsafe_error);
+
+  // PublicMpid names are chosen, so are carried in the blob.
+  Anmpid anmpid;
+  std::vector<PublicMpid> public_mpids;
+  public_mpids.emplace_back(Mpid(NonEmptyString(RandomAlphaNumericString(10)), anmpid));
+  public_mpids.emplace_back(Mpid(NonEmptyString(RandomAlphaNumericString(20)), anmpid));
+  const std::string encoded_mpids(detail::EncodePublicFobs(public_mpids));
+  const detail::PublicFobsView<detail::MpidTag> mpids_view(encoded_mpids);
+  ASSERT_EQ(2U, mpids_view.size());
+  EXPECT_EQ(public_mpids[1].name(), mpids_view.Decode(1).name());
+  EXPECT_EQ(public_mpids[0].validation_token().string(), mpids_view.View(0).validation_token());
+  EXPECT_EQ(encoded_mpids,
+            detail::EncodePublicFobs(detail::DecodePublicFobs<detail::MpidTag>(encoded_mpids)));
+
+  const std::string encoded_none(detail::EncodePublicFobs(std::vector<PublicPmid>()));
+  EXPECT_TRUE(detail::PublicFobsView<detail::PmidTag>(encoded_none).empty());
+  EXPECT_TRUE(detail::DecodePublicFobs<detail::PmidTag>(encoded_none).empty());
+}
+
+TEST(PublicFobCodecTest, BEH_RejectsMalformed) {
+  const std::string encoded(detail::EncodePublicFobs(MakePublicPmids(3)));
+  typedef detail::PublicFobsView<detail::PmidTag> PmidsView;
+
+  EXPECT_THROW(PmidsView{ detail::ByteView() }, maidsafe_error);
+  EXPECT_THROW(PmidsView{ detail::ByteView(encoded).substr(0, encoded.size() - 1) },
+               maidsafe_error);
+  EXPECT_THROW(PmidsView{ encoded + 'x' }, maidsafe_error);
+  EXPECT_THROW(detail::PublicFobsView<detail::MaidTag>{ encoded }, maidsafe_error);
+  std::string huge_count(encoded);
+  huge_count[5] = static_cast<char>(0xFF);
+  EXPECT_THROW(PmidsView{ huge_count }, maidsafe_error);
+  std::string unordered(encoded);
+  detail::PutUint32(encoded.size() - 1, &unordered[detail::kPublicFobsHeaderSize + 4]);
+  EXPECT_THROW(PmidsView{ unordered }, maidsafe_error);
+
+  // A malformed element is only found when it's accessed.
+  std::string bad_element(encoded);
+  const std::size_t second(detail::GetUint32(encoded, detail::kPublicFobsHeaderSize + 4));
+  bad_element[second + 2] ^= 1;
+  const PmidsView view(bad_element);
+  EXPECT_NO_THROW(view.View(0));
+  EXPECT_NO_THROW(view.Decode(0));
+  EXPECT_THROW(view.View(1), maidsafe_error);
+  EXPECT_THROW(detail::DecodePublicFobs<detail::PmidTag>(bad_element), maidsafe_error);
+}
+
+TEST(PublicFobCodecTest, FUNC_BulkThroughput) {
+  // A vault shipping its close group's PublicPmids: one Serialise() per element against a single
+  // bulk blob, and decoding that blob on one thread against all cores.  Allocations are counted on
+  // this thread only, so the zero-allocation random access can't be disturbed by KeyPool refills.
+  const std::size_t kCount(64), kRounds(20);
+  const std::vector<PublicPmid> public_pmids(MakePublicPmids(kCount));
+
+  auto time([&](const std::function<void()>& operation) {
+    const std::size_t before(AllocationCount());
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t round(0); round != kRounds; ++round)
+      operation();
+    const double seconds(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return std::make_pair(AllocationCount() - before, seconds);
+  });
+
+  std::size_t per_element_size(0), bulk_size(0);
+  const auto per_element(time([&] {
+    per_element_size = 0;
+    for (const auto& public_pmid : public_pmids)
+      per_element_size += public_pmid.Serialise()->string().size();
+  }));
+  std::string encoded;
+  const auto bulk(time([&] {
+    encoded = detail::EncodePublicFobs(public_pmids);
+    bulk_size = encoded.size();
+  }));
+  const auto decode_single(time([&] {
+    EXPECT_EQ(kCount, detail::DecodePublicFobs<detail::PmidTag>(encoded, 1).size());
+  }));
+  const auto decode_parallel(time([&] {
+    EXPECT_EQ(kCount, detail::DecodePublicFobs<detail::PmidTag>(encoded).size());
+  }));
+  const auto random_access(time([&] {
+    const detail::PublicFobsView<detail::PmidTag> view(encoded);
+    EXPECT_FALSE(view.View(kCount / 2).serialised().empty());
+  }));
+
+  EXPECT_LT(bulk.first, per_element.first);
+  EXPECT_EQ(0U, random_access.first);
+  LOG(kInfo) << kCount << " PublicPmids: per-element Serialise " << per_element_size << " bytes, "
+             << per_element.first / kRounds << " allocations, " << per_element.second / kRounds
+             << "s; bulk encode " << bulk_size << " bytes, " << bulk.first / kRounds
+             << " allocations, " << bulk.second / kRounds << "s";
+  LOG(kInfo) << "Bulk decode " << decode_single.second / kRounds << "s on one thread, "
+             << decode_parallel.second / kRounds << "s on all cores; random access to one "
+             << "element " << random_access.second / kRounds << "s";
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -18,9 +18,19 @@
 
 #include "maidsafe/passport/detail/public_fob.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "maidsafe/common/log.h"
 #include "maidsafe/common/test.h"
 #include "maidsafe/common/utils.h"
 
+#include "maidsafe/passport/passport.h"
 #include "maidsafe/passport/types.h"
 
 #include "maidsafe/common/serialisation/serialisation.h"
@@ -246,6 +256,173 @@ TEST(PublicFobTest, BEH_DoNotConstructPublicFobsFromUninitialisedStrings) {
       std::exception);
 }
 
+namespace {
+
+// Matches the layout written by PublicFob::save, but allows arbitrary key bytes.
+struct PublicFobCereal {
+  template <typename Archive>
+  Archive& serialize(Archive& ref_archive) {
+    return ref_archive(tag, public_key, validation_token);
+  }
+
+  std::uint32_t tag;
+  std::string public_key;
+  asymm::Signature validation_token;
+};
+
+}  // unnamed namespace
+
+TEST(PublicFobTest, BEH_LazyPublicKeyDecoding) {
+  Pmid pmid{ Anpmid{} };
+  const PublicPmid public_pmid{ pmid };
+  EXPECT_TRUE(public_pmid.public_key_decoded());
+
+  // Parsing leaves the key encoded until it's needed, and copies share it once decoded.
+  const PublicPmid parsed{ public_pmid.name(), public_pmid.Serialise() };
+  EXPECT_FALSE(parsed.public_key_decoded());
+  EXPECT_EQ(public_pmid.encoded_public_key(), parsed.encoded_public_key());
+  EXPECT_EQ(public_pmid.Serialise(), parsed.Serialise());
+  EXPECT_FALSE(parsed.public_key_decoded());
+  const PublicPmid undecoded_copy{ parsed };
+  EXPECT_TRUE(asymm::MatchingKeys(pmid.public_key(), parsed.public_key()));
+  EXPECT_TRUE(parsed.public_key_decoded());
+  EXPECT_FALSE(undecoded_copy.public_key_decoded());
+  const PublicPmid decoded_copy{ parsed };
+  EXPECT_TRUE(decoded_copy.public_key_decoded());
+  EXPECT_EQ(&parsed.public_key_ref(), &decoded_copy.public_key_ref());
+
+  // An invalid key is reported when it's first used rather than when parsed.
+  PublicFobCereal cereal;
+  cereal.tag = static_cast<std::uint32_t>(PublicPmid::Tag::kValue);
+  cereal.public_key = RandomString(256);
+  cereal.validation_token = public_pmid.validation_token();
+  const PublicPmid invalid{ public_pmid.name(), PublicPmid::serialised_type{ NonEmptyString{
+                                                    maidsafe::ConvertToString(cereal) } } };
+  EXPECT_THROW(invalid.public_key(), maidsafe_error);
+  EXPECT_THROW(invalid.public_key_ref(), maidsafe_error);
+  EXPECT_FALSE(invalid.public_key_decoded());
+}
+
+TEST(PublicFobTest, BEH_ValidateAgainst) {
+  Anmaid anmaid, other_anmaid;
+  Maid maid(anmaid);
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  Anmpid anmpid;
+  Mpid mpid(NonEmptyString(RandomAlphaNumericString(1 + RandomUint32() % 100)), anmpid);
+
+  const PublicAnmaid public_anmaid(anmaid), public_other_anmaid(other_anmaid);
+  const PublicMaid public_maid(maid);
+  const PublicAnpmid public_anpmid(anpmid);
+  const PublicPmid public_pmid(pmid);
+  const PublicMpid public_mpid(mpid);
+
+  EXPECT_TRUE(public_anmaid.ValidateAgainst(public_anmaid));
+  EXPECT_TRUE(public_maid.ValidateAgainst(public_anmaid));
+  EXPECT_TRUE(public_pmid.ValidateAgainst(public_anpmid));
+  EXPECT_TRUE(public_mpid.ValidateAgainst(PublicAnmpid{ anmpid }));
+  EXPECT_FALSE(public_maid.ValidateAgainst(public_other_anmaid));
+  EXPECT_FALSE(public_anmaid.ValidateAgainst(public_other_anmaid));
+
+  // Repeats, including of failures and by parsed copies, are answered from the cache.
+  const auto before(detail::VerificationCache::Instance().GetStatistics());
+  const PublicAnmaid parsed_anmaid(public_anmaid.name(), public_anmaid.Serialise());
+  EXPECT_TRUE(public_maid.ValidateAgainst(parsed_anmaid));
+  EXPECT_FALSE(parsed_anmaid.public_key_decoded());
+  EXPECT_FALSE(public_maid.ValidateAgainst(public_other_anmaid));
+  EXPECT_GE(detail::VerificationCache::Instance().GetStatistics().hits, before.hits + 2);
+}
+
+TEST(PublicFobTest, BEH_ValidateSignerChains) {
+  typedef std::pair<PublicPmid, PublicAnpmid> Chain;
+  std::vector<Chain> chains;
+  for (auto& pmid_and_signer : CreatePmidAndSignerBatch(6))
+    chains.emplace_back(PublicPmid{ pmid_and_signer.first },
+                        PublicAnpmid{ pmid_and_signer.second });
+
+  // Chain 1 has the wrong signer, chain 3 a Pmid whose name isn't derived from its key, and chain 4
+  // a signer whose name isn't derived from its key.
+  chains[1].second = PublicAnpmid{ Anpmid{} };
+  chains[3].first = PublicPmid{ PublicPmid::Name{ Identity{ RandomString(64) } },
+                                chains[3].first.Serialise() };
+  chains[4].second = PublicAnpmid{ PublicAnpmid::Name{ Identity{ RandomString(64) } },
+                                   chains[4].second.Serialise() };
+
+  const std::vector<bool> expected{ true, false, true, false, false, true };
+  EXPECT_EQ(expected, detail::ValidateSignerChains(chains));
+  EXPECT_EQ(expected, detail::ValidateSignerChains(chains, 1));
+  EXPECT_EQ(std::vector<bool>(expected.begin() + 2, expected.end()),
+            detail::ValidateSignerChains(chains.data() + 2, chains.size() - 2, 3));
+  EXPECT_TRUE(detail::ValidateSignerChains(chains.data(), 0).empty());
+
+  // A PublicMpid's name is user-chosen, so only its signature is checked.
+  Anmpid anmpid;
+  const PublicMpid public_mpid(Mpid{ NonEmptyString{ RandomString(10) }, anmpid });
+  EXPECT_TRUE(detail::ValidateSignerChain(public_mpid, PublicAnmpid{ anmpid }));
+  EXPECT_FALSE(detail::ValidateSignerChain(public_mpid, PublicAnmpid{ Anmpid{} }));
+}
+
+TEST(PublicFobTest, FUNC_SignerChainThroughput) {
+  // Mirrors a vault group verifying the PublicPmids of a large number of nodes.
+  const std::size_t kChainCount(2000);
+  std::vector<std::pair<PublicPmid, PublicAnpmid>> chains;
+  for (auto& pmid_and_signer : CreatePmidAndSignerBatch(kChainCount))
+    chains.emplace_back(PublicPmid{ pmid_and_signer.first },
+                        PublicAnpmid{ pmid_and_signer.second });
+
+  const unsigned core_count(std::max(1U, std::thread::hardware_concurrency()));
+  for (unsigned thread_count : { 1U, core_count }) {
+    // Parse afresh and clear the verification cache so that every key is decoded and every
+    // signature checked.
+    std::vector<std::pair<PublicPmid, PublicAnpmid>> parsed;
+    for (const auto& chain : chains) {
+      parsed.emplace_back(PublicPmid{ chain.first.name(), chain.first.Serialise() },
+                          PublicAnpmid{ chain.second.name(), chain.second.Serialise() });
+    }
+    detail::VerificationCache::Instance().Clear();
+
+    const auto start(std::chrono::steady_clock::now());
+    const std::vector<bool> results(detail::ValidateSignerChains(parsed, thread_count));
+    const double elapsed(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    EXPECT_EQ(std::vector<bool>(kChainCount, true), results);
+    LOG(kInfo) << "Validated " << kChainCount << " PublicPmid chains on " << thread_count
+               << " thread(s) in " << elapsed << "s: "
+               << kChainCount / elapsed / std::min(thread_count, core_count)
+               << " chains per second per core";
+  }
+}
+
+TEST(PublicFobTest, FUNC_LazyPublicKeyDecodingCost) {
+  // Compares parsing public fobs which are only forwarded against parsing and using them.
+  const std::size_t count(1000);
+  std::vector<PublicPmid> public_pmids;
+  for (std::size_t i(0); i != 10; ++i)
+    public_pmids.emplace_back(Pmid{ Anpmid{} });
+  std::vector<PublicPmid::serialised_type> serialised;
+  for (std::size_t i(0); i != count; ++i)
+    serialised.push_back(public_pmids[i % public_pmids.size()].Serialise());
+
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t i(0); i != count; ++i) {
+    const PublicPmid parsed{ public_pmids[i % public_pmids.size()].name(), serialised[i] };
+    EXPECT_FALSE(parsed.public_key_decoded());
+  }
+  const double parse_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i(0); i != count; ++i) {
+    const PublicPmid parsed{ public_pmids[i % public_pmids.size()].name(), serialised[i] };
+    parsed.public_key_ref();
+  }
+  const double decode_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  LOG(kInfo) << "Parsing " << count << " PublicPmids: " << parse_time << "s without using the key, "
+             << decode_time << "s using it";
+}
+
 }  // namespace test
 
 }  // namespace passport
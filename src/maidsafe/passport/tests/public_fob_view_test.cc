@@ -0,0 +1,141 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+
+#include "maidsafe/passport/detail/public_fob_view.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+#include "maidsafe/passport/tests/allocation_counter.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+TEST(PublicFobViewTest, BEH_FieldsInPlace) {
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  const PublicPmid public_pmid(pmid);
+  const PublicPmid::serialised_type serialised(public_pmid.Serialise(detail::WireFormat::kV2));
+
+  const PublicPmidView view(serialised);
+  const std::string& bytes(serialised.data.string());
+  EXPECT_EQ(DataTagValue::kPmidValue, view.tag());
+  EXPECT_EQ(public_pmid.encoded_public_key().string(), view.encoded_public_key());
+  EXPECT_EQ(public_pmid.validation_token().string(), view.validation_token());
+  EXPECT_EQ(bytes, view.serialised());
+  // The fields are views into the serialised bytes, not copies.
+  EXPECT_EQ(bytes.data() + detail::kCompactPublicFobHeaderSize, view.encoded_public_key().data());
+  EXPECT_EQ(bytes.data() + bytes.size() - view.validation_token().size(),
+            view.validation_token().data());
+
+  const PublicPmid parsed(view.ToPublicFob(public_pmid.name()));
+  EXPECT_EQ(public_pmid.name(), parsed.name());
+  EXPECT_EQ(public_pmid.Serialise(), parsed.Serialise());
+  EXPECT_TRUE(parsed.ValidateAgainst(PublicAnpmid(anpmid)));
+
+  // Forwarded bytes are accepted as they are by another view or a PublicFob.
+  const std::string forwarded(view.serialised().to_string());
+  EXPECT_EQ(view.encoded_public_key(), PublicPmidView(forwarded).encoded_public_key());
+  EXPECT_EQ(public_pmid.Serialise(),
+            PublicPmid(public_pmid.name(), PublicPmid::serialised_type(NonEmptyString(forwarded)))
+                .Serialise());
+}
+
+TEST(PublicFobViewTest, BEH_RejectsMalformed) {
+  Anmaid anmaid;
+  Maid maid(anmaid);
+  const PublicMaid public_maid(maid);
+  const std::string v2(public_maid.Serialise(detail::WireFormat::kV2)->string());
+
+  EXPECT_THROW(PublicMaidView{ public_maid.Serialise() }, maidsafe_error);
+  EXPECT_THROW(PublicMaidView{ PublicMaid::serialised_type() }, maidsafe_error);
+  EXPECT_THROW(PublicMaidView{ detail::ByteView() }, maidsafe_error);
+  EXPECT_THROW(PublicMaidView{ detail::ByteView(v2).substr(0, v2.size() - 1) }, maidsafe_error);
+  EXPECT_THROW(PublicMaidView{ v2 + 'x' }, maidsafe_error);
+  EXPECT_THROW(PublicAnmaidView{ v2 }, maidsafe_error);
+  std::string wrong_size(v2);
+  wrong_size[2] ^= 1;
+  EXPECT_THROW(PublicMaidView{ wrong_size }, maidsafe_error);
+
+  // A view checks only the layout, not the key encoding.
+  std::string bad_key(v2);
+  bad_key[detail::kCompactPublicFobHeaderSize] ^= 0x7F;
+  const PublicMaidView bad_key_view(bad_key);
+  EXPECT_EQ(bad_key.size(), bad_key_view.serialised().size());
+}
+
+TEST(PublicFobViewTest, FUNC_ForwardingCost) {
+  // A vault forwarding received public fobs: parse each into a PublicFob and re-serialise it,
+  // against checking it with a view and forwarding the received bytes.  Allocations are counted on
+  // this thread only, so KeyPool refills running alongside can't register against the view.
+  const std::size_t kCount(100), kRounds(10);
+  std::vector<std::string> received;
+  std::vector<PublicPmid::Name> names;
+  for (std::size_t i(0); i != kCount; ++i) {
+    Anpmid anpmid;
+    Pmid pmid(anpmid);
+    const PublicPmid public_pmid(pmid);
+    received.push_back(public_pmid.Serialise(detail::WireFormat::kV2)->string());
+    names.push_back(public_pmid.name());
+  }
+
+  std::vector<std::string> forwarded(kCount);
+  auto measure([&](bool use_view) {
+    const std::size_t before(AllocationCount());
+    auto start(std::chrono::steady_clock::now());
+    for (std::size_t round(0); round != kRounds; ++round) {
+      for (std::size_t i(0); i != kCount; ++i) {
+        if (use_view) {
+          const PublicPmidView view(received[i]);
+          forwarded[i].assign(view.serialised().data(), view.serialised().size());
+        } else {
+          const PublicPmid public_pmid(names[i], detail::ByteView(received[i]));
+          forwarded[i] = public_pmid.Serialise(detail::WireFormat::kV2)->string();
+        }
+      }
+    }
+    const double time(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    EXPECT_EQ(received, forwarded);
+    return std::make_pair(AllocationCount() - before, time);
+  });
+
+  const auto parsing(measure(false));
+  const auto viewing(measure(true));
+  EXPECT_EQ(0U, viewing.first);
+  EXPECT_LT(viewing.first, parsing.first);
+  LOG(kInfo) << kCount * kRounds << " public fobs forwarded: parsing " << parsing.first
+             << " allocations in " << parsing.second << "s, viewing " << viewing.first
+             << " allocations in " << viewing.second << "s";
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -0,0 +1,162 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/serialisation_buffer.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+#include "maidsafe/common/serialisation/serialisation.h"
+
+#include "maidsafe/passport/passport.h"
+#include "maidsafe/passport/types.h"
+#include "maidsafe/passport/detail/passport_cereal.h"
+#include "maidsafe/passport/detail/wipe.h"
+#include "maidsafe/passport/tests/allocation_counter.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+TEST(SerialisationBufferTest, BEH_MatchesConvertToString) {
+  Anpmid anpmid;
+  Pmid pmid(anpmid);
+  const PublicPmid public_pmid(pmid);
+  const std::string text(RandomString(100));
+  const std::uint32_t number(RandomUint32());
+
+  detail::SerialisationBuffer buffer;
+  pmid.SerialiseInto(buffer);
+  EXPECT_EQ(pmid.ToCereal(), buffer.string());
+  buffer.Clear();
+  EXPECT_EQ(0U, buffer.size());
+  public_pmid.SerialiseInto(buffer);
+  EXPECT_EQ(public_pmid.Serialise()->string(), buffer.string());
+  buffer.Clear();
+  buffer.Write(text);
+  buffer.Write(number);
+  EXPECT_EQ(maidsafe::ConvertToString(text) + maidsafe::ConvertToString(number), buffer.string());
+
+  // A nested object written in place matches one serialised separately and written as a string.
+  detail::KeyAndSignerCereal cereal;
+  cereal.key_ = pmid.ToCereal();
+  cereal.signer_ = anpmid.ToCereal();
+  buffer.Clear();
+  buffer.WriteString([&](detail::SerialisationBuffer&) { pmid.SerialiseInto(buffer); });
+  buffer.WriteString([&](detail::SerialisationBuffer&) { buffer.WriteBytes(cereal.signer_); });
+  EXPECT_EQ(maidsafe::ConvertToString(cereal), buffer.string());
+  buffer.Clear();
+  buffer.WriteString([](detail::SerialisationBuffer&) {});
+  EXPECT_EQ(maidsafe::ConvertToString(std::string()), buffer.string());
+
+  const std::string released(buffer.Release());
+  EXPECT_EQ(maidsafe::ConvertToString(std::string()), released);
+  EXPECT_EQ(0U, buffer.size());
+}
+
+TEST(SerialisationBufferTest, BEH_Wipe) {
+  const std::string secret(RandomString(100));
+  std::string copy(secret);
+  detail::Wipe(copy);
+  EXPECT_EQ(std::string(100, '\0'), copy);
+
+  const std::shared_ptr<const NonEmptyString> wiped_on_release(detail::MakeWipedOnRelease(secret));
+  EXPECT_EQ(secret, wiped_on_release->string());
+}
+
+TEST(SerialisationBufferTest, FUNC_PassportSerialisationCost) {
+  // Compares the double serialisation Passport used (each fob to a string, copied into the cereal
+  // struct, which is serialised again) with writing the same layout in one pass into a reused
+  // buffer, as Passport now does.
+  const std::size_t kPmidCount(100), kIterations(100);
+  const MaidAndSigner maid_and_signer(CreateMaidAndSigner());
+  const std::vector<PmidAndSigner> pmids_and_signers(CreatePmidAndSignerBatch(kPmidCount));
+
+  auto double_serialise([&] {
+    detail::PassportCereal cereal_passport;
+    cereal_passport.maid_and_signer_.key_ = maid_and_signer.first.ToCereal();
+    cereal_passport.maid_and_signer_.signer_ = maid_and_signer.second.ToCereal();
+    for (const auto& pmid_and_signer : pmids_and_signers) {
+      cereal_passport.pmids_and_signers_.emplace_back();
+      cereal_passport.pmids_and_signers_.back().key_ = pmid_and_signer.first.ToCereal();
+      cereal_passport.pmids_and_signers_.back().signer_ = pmid_and_signer.second.ToCereal();
+    }
+    return maidsafe::ConvertToString(cereal_passport);
+  });
+
+  detail::SerialisationBuffer buffer;
+  auto single_pass([&] {
+    buffer.Clear();
+    buffer.WriteString([&](detail::SerialisationBuffer&) {
+      maid_and_signer.first.SerialiseInto(buffer);
+    });
+    buffer.WriteString([&](detail::SerialisationBuffer&) {
+      maid_and_signer.second.SerialiseInto(buffer);
+    });
+    buffer.Write(static_cast<cereal::size_type>(pmids_and_signers.size()));
+    for (const auto& pmid_and_signer : pmids_and_signers) {
+      buffer.WriteString([&](detail::SerialisationBuffer&) {
+        pmid_and_signer.first.SerialiseInto(buffer);
+      });
+      buffer.WriteString([&](detail::SerialisationBuffer&) {
+        pmid_and_signer.second.SerialiseInto(buffer);
+      });
+    }
+    buffer.Write(static_cast<cereal::size_type>(0));
+  });
+
+  single_pass();
+  ASSERT_EQ(double_serialise(), buffer.string());
+
+  std::size_t allocations_before(AllocationCount());
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t i(0); i != kIterations; ++i)
+    double_serialise();
+  const double double_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const std::size_t double_allocations(AllocationCount() - allocations_before);
+
+  allocations_before = AllocationCount();
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i(0); i != kIterations; ++i)
+    single_pass();
+  const double single_time(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const std::size_t single_allocations(AllocationCount() - allocations_before);
+
+  EXPECT_LT(single_allocations, double_allocations);
+  LOG(kInfo) << "Serialising a passport with " << kPmidCount << " Pmids: double serialisation "
+             << double_time / kIterations * 1e6 << "us and "
+             << double_allocations / kIterations << " allocations, single pass "
+             << single_time / kIterations * 1e6 << "us and "
+             << single_allocations / kIterations << " allocations";
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe
@@ -0,0 +1,128 @@
+/*  Copyright 2014 MaidSafe.net limited
+
+    This MaidSafe Software is licensed to you under (1) the MaidSafe.net Commercial License,
+    version 1.0 or later, or (2) The General Public License (GPL), version 3, depending on which
+    licence you accepted on initial access to the Software (the "Licences").
+
+    By contributing code to the MaidSafe Software, or to this project generally, you agree to be
+    bound by the terms of the MaidSafe Contributor Agreement, version 1.0, found in the root
+    directory of this project at LICENSE, COPYING and CONTRIBUTOR respectively and also
+    available at: http://www.maidsafe.net/licenses
+
+    Unless required by applicable law or agreed to in writing, the MaidSafe Software distributed
+    under the GPL Licence is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS
+    OF ANY KIND, either express or implied.
+
+    See the Licences for the specific language governing permissions and limitations relating to
+    use of the MaidSafe Software.                                                                 */
+
+#include "maidsafe/passport/detail/verification_cache.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "maidsafe/common/error.h"
+#include "maidsafe/common/log.h"
+#include "maidsafe/common/rsa.h"
+#include "maidsafe/common/test.h"
+#include "maidsafe/common/utils.h"
+
+#include "maidsafe/passport/types.h"
+
+namespace maidsafe {
+
+namespace passport {
+
+namespace test {
+
+TEST(VerificationCacheTest, BEH_HitsMissesAndEviction) {
+  detail::VerificationCache cache(2);
+  const std::string a(RandomString(10)), b(RandomString(10)), c(RandomString(10));
+  int verify_count(0);
+  auto verify_true([&] { ++verify_count; return true; });
+  auto verify_false([&] { ++verify_count; return false; });
+
+  EXPECT_TRUE(cache.Verify({ a }, verify_true));
+  EXPECT_TRUE(cache.Verify({ a }, verify_false));
+  EXPECT_FALSE(cache.Verify({ b }, verify_false));
+  EXPECT_FALSE(cache.Verify({ b }, verify_true));
+  EXPECT_EQ(2, verify_count);
+  auto statistics(cache.GetStatistics());
+  EXPECT_EQ(2U, statistics.hits);
+  EXPECT_EQ(2U, statistics.misses);
+  EXPECT_EQ(2U, statistics.entry_count);
+  EXPECT_DOUBLE_EQ(0.5, statistics.hit_ratio);
+
+  // The least recently used entry goes first.
+  EXPECT_TRUE(cache.Verify({ a }, verify_false));
+  EXPECT_TRUE(cache.Verify({ c }, verify_true));
+  EXPECT_EQ(3, verify_count);
+  EXPECT_TRUE(cache.Verify({ a }, verify_false));
+  EXPECT_TRUE(cache.Verify({ b }, verify_true));
+  EXPECT_EQ(4, verify_count);
+  EXPECT_EQ(2U, cache.GetStatistics().entry_count);
+
+  // Results of verifications which throw aren't cached.
+  EXPECT_THROW(cache.Verify({ c, a }, [&]() -> bool {
+                 BOOST_THROW_EXCEPTION(MakeError(CommonErrors::parsing_error));
+               }), maidsafe_error);
+  EXPECT_FALSE(cache.Verify({ c, a }, verify_false));
+
+  cache.Clear();
+  EXPECT_EQ(0U, cache.GetStatistics().entry_count);
+  EXPECT_FALSE(cache.Verify({ b }, verify_false));
+}
+
+TEST(VerificationCacheTest, BEH_InputBoundariesAreDistinct) {
+  detail::VerificationCache cache(16);
+  const std::string ab("ab"), c("c"), a("a"), bc("bc"), abc("abc");
+  EXPECT_TRUE(cache.Verify({ ab, c }, [] { return true; }));
+  EXPECT_FALSE(cache.Verify({ a, bc }, [] { return false; }));
+  EXPECT_FALSE(cache.Verify({ abc }, [] { return false; }));
+  EXPECT_EQ(0U, cache.GetStatistics().hits);
+}
+
+TEST(VerificationCacheTest, FUNC_RepeatedValidation) {
+  // Mirrors a vault checking the same few PublicPmids against their PublicAnpmids per request.
+  const std::size_t kFobCount(8), kRounds(100);
+  std::vector<PublicAnpmid> public_anpmids;
+  std::vector<PublicPmid> public_pmids;
+  for (std::size_t i(0); i != kFobCount; ++i) {
+    Anpmid anpmid;
+    public_anpmids.emplace_back(anpmid);
+    public_pmids.emplace_back(Pmid{ anpmid });
+  }
+
+  auto start(std::chrono::steady_clock::now());
+  for (std::size_t round(0); round != kRounds; ++round) {
+    for (std::size_t i(0); i != kFobCount; ++i) {
+      EXPECT_TRUE(asymm::CheckSignature(asymm::PlainText{ public_pmids[i].encoded_public_key() },
+                                        public_pmids[i].validation_token(),
+                                        public_anpmids[i].public_key()));
+    }
+  }
+  const double uncached(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+  const auto before(detail::VerificationCache::Instance().GetStatistics());
+  start = std::chrono::steady_clock::now();
+  for (std::size_t round(0); round != kRounds; ++round) {
+    for (std::size_t i(0); i != kFobCount; ++i)
+      EXPECT_TRUE(public_pmids[i].ValidateAgainst(public_anpmids[i]));
+  }
+  const double cached(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  const auto after(detail::VerificationCache::Instance().GetStatistics());
+  EXPECT_GE(after.hits - before.hits, kFobCount * (kRounds - 1));
+
+  LOG(kInfo) << kFobCount * kRounds << " validation token checks: uncached " << uncached
+             << "s, cached " << cached << "s, speedup " << uncached / cached
+             << ", process-wide hit ratio " << after.hit_ratio;
+}
+
+}  // namespace test
+
+}  // namespace passport
+
+}  // namespace maidsafe